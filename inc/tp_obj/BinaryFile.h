@@ -0,0 +1,112 @@
+#pragma once
+
+#include "tp_obj/Globals.h"
+
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <string_view>
+
+namespace tp_obj
+{
+struct FileStamp;
+
+//##################################################################################################
+//! Writes values in native byte order to a file, used for the cache and index files.
+class TP_OBJ_EXPORT BinaryWriter
+{
+  TP_NONCOPYABLE(BinaryWriter);
+public:
+  //################################################################################################
+  BinaryWriter(const std::string& path);
+
+  //################################################################################################
+  template<typename T>
+  void write(const T& value)
+  {
+    m_stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+
+  //################################################################################################
+  void writeString(const std::string& value);
+
+  //################################################################################################
+  void writeStamp(const FileStamp& stamp);
+
+  //################################################################################################
+  template<typename T>
+  void writeArray(const std::vector<T>& values)
+  {
+    write(uint64_t(values.size()));
+    m_stream.write(reinterpret_cast<const char*>(values.data()), std::streamsize(values.size()*sizeof(T)));
+  }
+
+  //################################################################################################
+  //! Returns false if anything failed to write.
+  bool close();
+
+private:
+  std::ofstream m_stream;
+};
+
+//##################################################################################################
+//! Reads values written by BinaryWriter, every read checks that there is enough data left.
+class TP_OBJ_EXPORT BinaryReader
+{
+public:
+  //################################################################################################
+  BinaryReader(std::string_view data);
+
+  //################################################################################################
+  template<typename T>
+  bool read(T& value)
+  {
+    if(m_data.size()-m_position<sizeof(T))
+      return false;
+
+    std::memcpy(&value, m_data.data()+m_position, sizeof(T));
+    m_position += sizeof(T);
+    return true;
+  }
+
+  //################################################################################################
+  bool readString(std::string& value);
+
+  //################################################################################################
+  bool readStamp(FileStamp& stamp);
+
+  //################################################################################################
+  template<typename T>
+  bool readArray(std::vector<T>& values)
+  {
+    uint64_t count=0;
+    if(!read(count) || (m_data.size()-m_position)/sizeof(T)<count)
+      return false;
+
+    values.resize(size_t(count));
+    std::memcpy(values.data(), m_data.data()+m_position, size_t(count)*sizeof(T));
+    m_position += size_t(count)*sizeof(T);
+    return true;
+  }
+
+private:
+  std::string_view m_data;
+  size_t m_position{0};
+};
+
+//##################################################################################################
+//! Write a file to a temporary path with closure and rename it into place.
+/*!
+Readers never see a partial file. The temporary file is next to path with a name that is unique to
+this write, so several threads or processes can write the same file at once and the last rename
+wins. If closure or the rename fails the temporary file is removed, an exception thrown by closure
+is passed on once it has been removed.
+*/
+bool TP_OBJ_EXPORT writeBinaryFile(const std::string& path,
+                                   const std::function<void(BinaryWriter&)>& closure);
+
+//##################################################################################################
+//! Returns the absolute form of path, or path itself if that fails.
+std::string TP_OBJ_EXPORT absolutePath(const std::string& path);
+
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "tp_obj/OutputBuffer.h"
+
+#include <string_view>
+
+namespace tp_obj
+{
+
+//##################################################################################################
+//! Compression formats that OBJ and MTL files can be read from and written to.
+/*!
+gzip needs tp_obj to be built with TP_OBJ_ZLIB defined and linked against zlib, zstd needs
+TP_OBJ_ZSTD and libzstd. Compressed input is detected from the first bytes of the file so the file
+name does not matter.
+*/
+enum class Compression
+{
+  None,
+  Gzip,
+  Zstd
+};
+
+//##################################################################################################
+//! Returns the compression of data from its magic bytes.
+Compression TP_OBJ_EXPORT detectCompression(std::string_view data);
+
+//##################################################################################################
+//! Returns true if this build of tp_obj can read and write the format.
+bool TP_OBJ_EXPORT compressionSupported(Compression compression);
+
+//##################################################################################################
+//! Returns the file extension for the format including the dot, or an empty string for None.
+std::string TP_OBJ_EXPORT compressionExtension(Compression compression);
+
+//##################################################################################################
+//! Pass the text of a file to closure in blocks of whole lines.
+/*!
+Compressed data is decompressed into a buffer of about blockSize bytes at a time so the whole
+decompressed text is never held in memory. The buffer grows if a single line is longer than it.
+Uncompressed data is passed as a single block without copying.
+
+\param data the contents of the file, compressed or not.
+\param closure called with each block and the fraction of data consumed so far, return false to
+stop.
+\param error set if the data could not be decompressed.
+\returns false if the data could not be decompressed or closure returned false.
+*/
+bool TP_OBJ_EXPORT forEachTextBlock(std::string_view data,
+                                    const std::function<bool(std::string_view text, float fraction)>& closure,
+                                    std::string& error,
+                                    size_t blockSize=1024*1024);
+
+//##################################################################################################
+//! Compresses the text passed to it and passes the result on to another sink.
+class TP_OBJ_EXPORT Compressor
+{
+  TP_NONCOPYABLE(Compressor);
+public:
+  //################################################################################################
+  /*!
+  \param level the compression level, -1 uses the default of the format.
+  */
+  Compressor(Compression compression, const OutputBuffer::Sink& sink, int level=-1);
+
+  //################################################################################################
+  ~Compressor();
+
+  //################################################################################################
+  //! Returns false if the format is not supported by this build or could not be initialized.
+  bool isValid() const;
+
+  //################################################################################################
+  bool write(const char* data, size_t size);
+
+  //################################################################################################
+  //! Write the end of the compressed stream, nothing can be written after this.
+  bool finish();
+
+  //################################################################################################
+  //! Returns a sink for an OutputBuffer that compresses into this.
+  OutputBuffer::Sink sink();
+
+private:
+  struct Private;
+  Private* d;
+  friend struct Private;
+};
+
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "tp_obj/Globals.h"
+
+namespace tp_obj
+{
+
+//##################################################################################################
+//! The size and modification time of a file, used to tell if a cached copy is still valid.
+struct TP_OBJ_EXPORT FileStamp
+{
+  bool exists{false};
+  uint64_t size{0};
+  int64_t modified{0};
+
+  bool operator==(const FileStamp& other) const
+  {
+    return exists==other.exists && size==other.size && modified==other.modified;
+  }
+};
+
+//##################################################################################################
+//! Returns the stamp of a file, exists is false if the file could not be found.
+FileStamp TP_OBJ_EXPORT fileStamp(const std::string& path);
+
+}
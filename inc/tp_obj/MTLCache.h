@@ -0,0 +1,71 @@
+#pragma once
+
+#include "tp_obj/MTLProperties.h"
+
+#include "tp_math_utils/Material.h"
+
+#include <memory>
+
+namespace tp_utils
+{
+class Progress;
+}
+
+namespace tp_obj
+{
+struct OBJStats;
+
+//##################################################################################################
+//! The materials read from one MTL file.
+struct TP_OBJ_EXPORT MTLLibrary
+{
+  std::vector<tp_math_utils::Material> materials;
+  std::vector<MTLProperties> properties; //!< One for each material.
+  std::string error;                     //!< Set if the file could not be read.
+};
+
+//##################################################################################################
+//! Parse an MTL file without consulting the cache.
+MTLLibrary TP_OBJ_EXPORT parseMTLLibrary(const std::string& filePath,
+                                         tp_utils::Progress* progress,
+                                         OBJStats* stats=nullptr);
+
+//##################################################################################################
+//! Returns the materials of an MTL file, parsing it only if it is not already in the cache.
+/*!
+The cache is shared by the whole process and is safe to use from several threads. Entries are
+keyed on the canonical path of the file and are parsed again if its size or modification time
+changes. If several threads ask for the same file at once it is only parsed once. Files that can't
+be found are parsed every time so that they are picked up when they appear. If the parse throws the
+exception is passed on to the threads waiting for it and the file is left out of the cache.
+
+The error of a library that could not be read is added to progress on every call, not just the one
+that parsed it, so a library that was parsed with no progress still reports its error.
+*/
+std::shared_ptr<const MTLLibrary> TP_OBJ_EXPORT cachedMTLLibrary(const std::string& filePath,
+                                                                 tp_utils::Progress* progress,
+                                                                 OBJStats* stats=nullptr);
+
+//##################################################################################################
+//! Set the estimated memory that the cache may use, the least recently used files are dropped.
+/*!
+The default is 64MB, set it to 0 to disable the cache.
+*/
+void TP_OBJ_EXPORT setMTLCacheCapacity(size_t bytes);
+
+//##################################################################################################
+size_t TP_OBJ_EXPORT mtlCacheCapacity();
+
+//##################################################################################################
+//! The estimated memory currently used by the cache.
+size_t TP_OBJ_EXPORT mtlCacheSize();
+
+//##################################################################################################
+//! Drop a file from the cache, use this if it could change without its modification time changing.
+void TP_OBJ_EXPORT invalidateMTLCache(const std::string& filePath);
+
+//##################################################################################################
+//! Drop every file from the cache.
+void TP_OBJ_EXPORT clearMTLCache();
+
+}
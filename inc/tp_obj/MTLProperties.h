@@ -0,0 +1,28 @@
+#pragma once
+
+#include "tp_obj/Globals.h"
+
+#include "glm/glm.hpp"
+
+namespace tp_obj
+{
+
+//##################################################################################################
+//! Wavefront material values that have no equivalent in the tp_math_utils material types.
+/*!
+parseMTL can fill one of these for each newmtl so that the values are not lost. Values that are
+missing from a material keep their defaults.
+*/
+struct TP_OBJ_EXPORT MTLProperties
+{
+  glm::vec3 ambient{0.0f, 0.0f, 0.0f};         //!< Ka
+  glm::vec3 specular{0.0f, 0.0f, 0.0f};        //!< Ks
+  float specularExponent{0.0f};                //!< Ns
+  float opticalDensity{1.0f};                  //!< Ni
+  int illuminationModel{-1};                   //!< illum, -1 if it was not set.
+  tp_utils::StringID specularTexture;          //!< map_Ks
+  tp_utils::StringID specularExponentTexture;  //!< map_Ns
+  tp_utils::StringID ambientOcclusionTexture;  //!< map_ao
+};
+
+}
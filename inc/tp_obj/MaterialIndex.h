@@ -0,0 +1,47 @@
+#pragma once
+
+#include "tp_obj/MTLCache.h"
+
+#include <unordered_map>
+
+namespace tp_obj
+{
+
+//##################################################################################################
+//! Materials from a list of MTL files indexed by name.
+/*!
+The materials are not copied, the index holds the libraries from the MTL cache and points into
+them. If several libraries contain a material with the same name the first one is used.
+*/
+struct TP_OBJ_EXPORT MaterialIndex
+{
+  //################################################################################################
+  struct Entry
+  {
+    const tp_math_utils::Material* material{nullptr};
+    const MTLProperties* properties{nullptr};
+  };
+
+  std::vector<std::shared_ptr<const MTLLibrary>> libraries;
+  std::unordered_map<tp_utils::StringID, Entry> byName;
+
+  //################################################################################################
+  //! Load the libraries and build the index, materials already in the index are kept.
+  void addLibraries(const std::vector<std::string>& materialLibraries,
+                    tp_utils::Progress* progress,
+                    OBJStats* stats=nullptr);
+
+  //################################################################################################
+  //! Add the libraries and materials of another index, materials already in this index are kept.
+  void merge(const MaterialIndex& other);
+
+  //################################################################################################
+  //! Returns the material with this name or nullptr if there isn't one.
+  const tp_math_utils::Material* find(const tp_utils::StringID& name) const;
+
+  //################################################################################################
+  //! Returns the extra MTL values for the material with this name or nullptr if there isn't one.
+  const MTLProperties* findProperties(const tp_utils::StringID& name) const;
+};
+
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "tp_obj/Globals.h"
+
+namespace tp_obj
+{
+struct OBJStats;
+
+//##################################################################################################
+//! Parses the MTL files named at the start of an OBJ file on another thread.
+/*!
+The first block of the OBJ file is scanned for mtllib lines and those libraries are loaded into the
+MTL cache while the caller parses the geometry. assignMaterials then finds them in the cache, or
+waits for them if they are still being parsed. Libraries named later in the file are loaded by
+assignMaterials as usual.
+
+Nothing is started if the MTL cache is disabled as the results would have nowhere to go.
+*/
+class TP_OBJ_EXPORT MaterialPrefetch
+{
+  TP_NONCOPYABLE(MaterialPrefetch);
+public:
+  //################################################################################################
+  MaterialPrefetch(const std::string& filePath, bool enabled=true);
+
+  //################################################################################################
+  //! Waits for the libraries to be parsed.
+  ~MaterialPrefetch();
+
+  //################################################################################################
+  //! Wait for the libraries to be parsed and add the stats of parsing them.
+  void join(OBJStats* stats);
+
+private:
+  struct Private;
+  Private* d;
+  friend struct Private;
+};
+
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "tp_obj/Globals.h"
+
+#include <string_view>
+
+namespace tp_obj
+{
+
+//##################################################################################################
+//! Parse a float from the start of text without using the locale.
+/*!
+This accepts the same forms as std::stof (optional sign, fixed or scientific notation, inf and nan)
+but works directly on views and never throws. Values too large for a float become inf and values
+too small become zero, callers that need finite values should check the result.
+
+The common fixed notation used by exporters (-?d+.d+) is handled by an exact fast path, everything
+else falls back to std::from_chars.
+
+\param text the token to parse, trailing characters after the number are ignored.
+\param value set to the parsed value on success.
+\returns false if text does not start with a number.
+*/
+bool TP_OBJ_EXPORT parseFloat(std::string_view text, float& value);
+
+}
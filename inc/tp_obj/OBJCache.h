@@ -0,0 +1,71 @@
+#pragma once
+
+#include "tp_obj/Globals.h"
+#include "tp_obj/FileStamp.h"
+
+#include "tp_math_utils/Geometry3D.h"
+
+namespace tp_obj
+{
+
+//##################################################################################################
+//! The parameters that an OBJ file was parsed with, part of the key of a cache file.
+struct OBJCacheParameters
+{
+  int triangleFan{0};
+  int triangleStrip{0};
+  int triangles{0};
+  bool reverse{false};
+  bool optimizeVertexOrder{false};
+  bool weld{false};
+  float weldPosition{0.0f};
+  float weldTexCoord{0.0f};
+  float weldNormal{0.0f};
+};
+
+//##################################################################################################
+//! Returns the path of the cache file for an OBJ file.
+/*!
+\param filePath the path of the OBJ file.
+\param cacheDirectory the directory to keep cache files in, if empty the cache file is placed next
+to the OBJ file.
+*/
+std::string TP_OBJ_EXPORT objCachePath(const std::string& filePath,
+                                       const std::string& cacheDirectory);
+
+//##################################################################################################
+//! Load geometry from a cache file if it is still valid.
+/*!
+The cache is valid if it was written for the same OBJ path, size, and modification time, with the
+same parameters, and none of the MTL files that the OBJ references have changed. The geometry is
+returned with only material names set, as from parseOBJGeometry.
+
+\returns false if there is no valid cache, the outputs are not modified in that case.
+*/
+bool TP_OBJ_EXPORT loadOBJCache(const std::string& cachePath,
+                                const std::string& filePath,
+                                const OBJCacheParameters& parameters,
+                                std::string& exporterVersion,
+                                std::vector<tp_math_utils::Geometry3D>& outputGeometry,
+                                std::vector<std::string>& materialLibraries);
+
+//##################################################################################################
+//! Write the result of parseOBJGeometry to a cache file.
+/*!
+The file is written to a temporary path and renamed into place so readers never see a partial
+file. Failing to write the cache is not an error for the load so this just returns false.
+
+\param stamp the stamp of the OBJ file taken before it was read, so that a file that changes while
+it is parsed does not match the cache.
+
+The MTL files are stamped when the cache is written, so call this before the materials are read.
+*/
+bool TP_OBJ_EXPORT saveOBJCache(const std::string& cachePath,
+                                const std::string& filePath,
+                                const FileStamp& stamp,
+                                const OBJCacheParameters& parameters,
+                                const std::string& exporterVersion,
+                                const std::vector<tp_math_utils::Geometry3D>& geometry,
+                                const std::vector<std::string>& materialLibraries);
+
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "tp_obj/Globals.h"
+#include "tp_obj/OBJReader.h"
+#include "tp_obj/FileStamp.h"
+
+#include <string_view>
+
+namespace tp_obj
+{
+
+//##################################################################################################
+//! A range of 0 based attribute indexes.
+struct TP_OBJ_EXPORT OBJIndexRange
+{
+  size_t first{0};
+  size_t count{0};
+
+  //################################################################################################
+  size_t end() const
+  {
+    return first+count;
+  }
+
+  //################################################################################################
+  bool overlaps(const OBJIndexRange& other) const
+  {
+    return count>0 && other.count>0 && first<other.end() && other.first<end();
+  }
+};
+
+//##################################################################################################
+//! A range of lines that only contains v, vt, and vn lines.
+struct TP_OBJ_EXPORT OBJAttributeBlock
+{
+  size_t offset{0};          //!< Byte offset of the first line.
+  size_t size{0};            //!< Length in bytes up to the end of the last line.
+  OBJIndexRange positions;   //!< The v lines in the block.
+  OBJIndexRange texCoords;   //!< The vt lines in the block.
+  OBJIndexRange normals;     //!< The vn lines in the block.
+};
+
+//##################################################################################################
+//! The lines from an o, g, or usemtl line up to the next one.
+struct TP_OBJ_EXPORT OBJSection
+{
+  std::string object;        //!< The name from the last o line.
+  std::string group;         //!< The name from the last g line.
+  std::string material;      //!< The name from the last usemtl line.
+  size_t offset{0};          //!< Byte offset of the o, g, or usemtl line that starts the section.
+  size_t size{0};            //!< Length in bytes up to the start of the next section.
+  size_t faces{0};           //!< The number of f lines in the section.
+  OBJIndexRange positions;   //!< The v indexes referenced by the faces.
+  OBJIndexRange texCoords;   //!< The vt indexes referenced by the faces.
+  OBJIndexRange normals;     //!< The vn indexes referenced by the faces.
+};
+
+//##################################################################################################
+//! Where the objects and attributes of an OBJ file are, used to load part of a file.
+/*!
+Building the index tokenizes the file and decodes the face lines but does not parse any numbers, so
+it is much quicker than a full parse. Faces reference attributes by their position in the whole
+file, so each section records the range of attributes it needs and the attribute lines are grouped
+into blocks that can be parsed on their own.
+
+Lines before the first o, g, or usemtl line that contain faces form a section with empty names.
+*/
+struct TP_OBJ_EXPORT OBJIndex
+{
+  std::string exporterVersion;
+  std::vector<std::string> materialLibraries; //!< From the mtllib lines, relative to the OBJ file.
+  size_t positions{0};                        //!< v lines in the file.
+  size_t texCoords{0};                        //!< vt lines in the file.
+  size_t normals{0};                          //!< vn lines in the file.
+  std::vector<OBJAttributeBlock> blocks;
+  std::vector<OBJSection> sections;
+};
+
+//##################################################################################################
+//! Index uncompressed OBJ text.
+/*!
+\param text the whole of the OBJ file, offsets in the index are relative to the start of this.
+\param maxBlockLines the longest run of attribute lines kept in a single block.
+*/
+void TP_OBJ_EXPORT buildOBJIndex(std::string_view text,
+                                 OBJIndex& index,
+                                 size_t maxBlockLines=4096);
+
+//##################################################################################################
+//! Returns the number of each attribute before an offset that is not inside an attribute block.
+OBJAttributeCounts TP_OBJ_EXPORT objAttributeCountsAt(const OBJIndex& index, size_t offset);
+
+//##################################################################################################
+//! Returns the path of the index file for an OBJ file, see objCachePath.
+std::string TP_OBJ_EXPORT objIndexPath(const std::string& filePath,
+                                       const std::string& cacheDirectory);
+
+//##################################################################################################
+//! Load an index from a file if it was written for the same OBJ path, size, and modification time.
+/*!
+\returns false if there is no valid index, index is not modified in that case.
+*/
+bool TP_OBJ_EXPORT loadOBJIndex(const std::string& indexPath,
+                                const std::string& filePath,
+                                OBJIndex& index);
+
+//##################################################################################################
+//! Write an index to a file, failing to write it is not an error so this just returns false.
+/*!
+\param stamp the stamp of the OBJ file taken before it was read, see saveOBJCache.
+*/
+bool TP_OBJ_EXPORT saveOBJIndex(const std::string& indexPath,
+                                const std::string& filePath,
+                                const FileStamp& stamp,
+                                const OBJIndex& index);
+
+}
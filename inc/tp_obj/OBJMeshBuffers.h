@@ -0,0 +1,83 @@
+#pragma once
+
+#include "tp_obj/Globals.h"
+
+#include "tp_math_utils/Material.h"
+
+#include "glm/glm.hpp"
+
+#include <cstdint>
+
+namespace tp_obj
+{
+
+//##################################################################################################
+//! Where each attribute of a vertex goes in an interleaved vertex buffer.
+/*!
+Offsets are in bytes from the start of a vertex, an attribute with an offset of -1 is not written.
+Positions and normals are written as 3 floats, tex coords as 2 floats. Each attribute that is
+written must fit inside stride, loading into buffers with a layout that is not valid fails.
+*/
+struct TP_OBJ_EXPORT OBJVertexLayout
+{
+  size_t stride{0};        //!< Bytes per vertex, 0 writes separate arrays for each attribute instead.
+  int positionOffset{0};   //!< Byte offset of the position.
+  int texCoordOffset{-1};  //!< Byte offset of the tex coord.
+  int normalOffset{-1};    //!< Byte offset of the normal.
+
+  //################################################################################################
+  //! Returns true if stride is 0 or each attribute that is written fits inside it.
+  bool isValid() const;
+};
+
+//##################################################################################################
+//! A range of the index buffer that is drawn with one material.
+/*!
+Each object in the file has its own range of verts, an object is split into several submeshes by g
+lines. The verts of the object are vertexCount verts from firstVertex and the indexes of the
+submesh only reference those.
+*/
+struct TP_OBJ_EXPORT OBJSubmesh
+{
+  std::string name;        //!< The name from the last o line.
+  size_t materialID{0};    //!< Index into OBJMeshBuffers::materials.
+  size_t firstIndex{0};    //!< Offset of the first index in OBJMeshBuffers::indexes.
+  size_t indexCount{0};    //!< The number of indexes, 3 for each triangle.
+  size_t firstVertex{0};   //!< The first vert of the object that the submesh belongs to.
+  size_t vertexCount{0};   //!< The number of verts in the object.
+};
+
+//##################################################################################################
+//! Meshes read straight into buffers that can be uploaded to the GPU.
+/*!
+All of the objects in a file share a single vertex buffer and a single index buffer of triangles.
+Set layout before loading, by default the positions, tex coords, and normals are written to their
+own arrays. If layout.stride is set they are written interleaved to vertices instead.
+
+Verts without a tex coord or normal get the same defaults as tp_math_utils::Vertex3D.
+*/
+struct TP_OBJ_EXPORT OBJMeshBuffers
+{
+  OBJVertexLayout layout;
+
+  size_t vertexCount{0};
+
+  std::vector<glm::vec3> positions;   //!< One for each vertex if layout.stride is 0.
+  std::vector<glm::vec2> texCoords;   //!< One for each vertex if layout.stride is 0.
+  std::vector<glm::vec3> normals;     //!< One for each vertex if layout.stride is 0.
+  std::vector<uint8_t> vertices;      //!< layout.stride bytes for each vertex if it is not 0.
+
+  std::vector<uint32_t> indexes;      //!< Indexes into the verts, 3 for each triangle.
+  std::vector<OBJSubmesh> submeshes;
+
+  //! One for each material name used by the file in the order they are first used. Materials that
+  //! are not found in the MTL files, or that are left in ParseOptions::sharedMaterials, only have
+  //! their name set.
+  std::vector<tp_math_utils::Material> materials;
+
+  //################################################################################################
+  //! Remove the meshes but keep the layout.
+  void clear();
+};
+
+}
@@ -1,9 +1,13 @@
 #pragma once
 
 #include "tp_obj/Globals.h"
+#include "tp_obj/ParseOptions.h"
 
 #include "tp_math_utils/Geometry3D.h"
 
+#include <memory_resource>
+#include <string_view>
+
 namespace tp_utils
 {
 class Progress;
@@ -11,9 +15,17 @@ class Progress;
 
 namespace tp_obj
 {
+struct OBJStats;
+struct MTLProperties;
+struct MaterialIndex;
+struct OBJIndex;
+struct OBJMeshBuffers;
 
 //##################################################################################################
 //! Read the file, split lines, read exporter version number, remove comments
+/*!
+This copies every token into a string, prefer LineTokenizer for large files.
+*/
 std::vector<std::vector<std::string>> parseLines(const std::string& filePath,
                                                  std::string* exporterVersion=nullptr);
 
@@ -25,12 +37,117 @@ bool TP_OBJ_EXPORT parseOBJ(const std::string& filePath,
                             bool reverse,
                             std::string& exporterVersion,
                             std::vector<tp_math_utils::Geometry3D>& outputGeometry,
-                            tp_utils::Progress* progress);
+                            tp_utils::Progress* progress,
+                            const ParseOptions& options=ParseOptions());
+
+//##################################################################################################
+//! Parse the geometry of an OBJ file without loading its materials.
+/*!
+The meshes only have the name of their material set. The paths of the MTL files referenced by the
+file are appended to materialLibraries, pass them to assignMaterials to load the materials.
+*/
+bool TP_OBJ_EXPORT parseOBJGeometry(const std::string& filePath,
+                                    int triangleFan,
+                                    int triangleStrip,
+                                    int triangles,
+                                    bool reverse,
+                                    std::string& exporterVersion,
+                                    std::vector<tp_math_utils::Geometry3D>& outputGeometry,
+                                    std::vector<std::string>& materialLibraries,
+                                    tp_utils::Progress* progress,
+                                    const ParseOptions& options=ParseOptions());
+
+//##################################################################################################
+//! Parse the geometry of an OBJ file into vertex and index buffers without loading its materials.
+/*!
+Anything already in outputBuffers is replaced, only its layout is kept, see OBJMeshBuffers. The
+materials only have their names set, pass materialLibraries to assignMaterials to load them. If
+parsing fails, or the layout is not valid, outputBuffers is left empty.
+*/
+bool TP_OBJ_EXPORT parseOBJBuffers(const std::string& filePath,
+                                   bool reverse,
+                                   std::string& exporterVersion,
+                                   OBJMeshBuffers& outputBuffers,
+                                   std::vector<std::string>& materialLibraries,
+                                   tp_utils::Progress* progress,
+                                   const ParseOptions& options=ParseOptions());
+
+//##################################################################################################
+//! Run the stages that ParseOptions selects for after a file is parsed.
+/*!
+Verts are welded if options.weld is set and then reordered if options.optimizeVertexOrder is set.
+The load functions call this, it is only needed when calling the parse functions directly.
+*/
+void TP_OBJ_EXPORT postProcessOBJ(std::vector<tp_math_utils::Geometry3D>& geometry,
+                                  const ParseOptions& options);
+
+//##################################################################################################
+//! Run the stages that ParseOptions selects for after a file is parsed on a set of buffers.
+void TP_OBJ_EXPORT postProcessOBJ(OBJMeshBuffers& buffers,
+                                  const ParseOptions& options);
+
+//##################################################################################################
+//! Parse some of the sections of an OBJ file using an index built from its text.
+/*!
+Only the attribute blocks that hold attributes referenced by the sections are parsed. Sections that
+are next to each other in the index are built exactly as a full parse would build them, the lines
+of sections without faces between them are read for their names. So passing every section gives the
+same meshes as parseOBJGeometry. A section that does not follow on from the one before it starts a
+new mesh named from the index, and a new object if the object or material name differs.
+
+\param text the uncompressed text of the file that the index was built from.
+\param index the index of the file, see buildOBJIndex.
+\param sections indexes into index.sections in ascending order.
+\param error set to a description of the problem if parsing fails.
+\param threadCount the threads used to parse the attribute blocks, 0 uses all hardware threads.
+\param stats if not nullptr the timings and counters of the parse are added to this.
+\param memoryResource where the temporaries of the parse get their memory, see
+ParseOptions::memoryResource.
+*/
+bool TP_OBJ_EXPORT parseOBJSections(std::string_view text,
+                                    const OBJIndex& index,
+                                    const std::vector<size_t>& sections,
+                                    int triangleFan,
+                                    int triangleStrip,
+                                    int triangles,
+                                    bool reverse,
+                                    std::vector<tp_math_utils::Geometry3D>& outputGeometry,
+                                    std::string& error,
+                                    size_t threadCount=1,
+                                    OBJStats* stats=nullptr,
+                                    std::pmr::memory_resource* memoryResource=nullptr);
+
+//##################################################################################################
+//! Load the MTL files and copy materials into the geometry with matching names.
+/*!
+\param sharedMaterials If not nullptr the materials are added to this index instead and the
+geometry is left with only the material names, see ParseOptions::sharedMaterials.
+*/
+void TP_OBJ_EXPORT assignMaterials(const std::vector<std::string>& materialLibraries,
+                                   std::vector<tp_math_utils::Geometry3D>& geometry,
+                                   tp_utils::Progress* progress,
+                                   OBJStats* stats=nullptr,
+                                   MaterialIndex* sharedMaterials=nullptr);
+
+//##################################################################################################
+//! Load the MTL files and replace the materials of the buffers that have a matching name.
+void TP_OBJ_EXPORT assignMaterials(const std::vector<std::string>& materialLibraries,
+                                   OBJMeshBuffers& buffers,
+                                   tp_utils::Progress* progress,
+                                   OBJStats* stats=nullptr,
+                                   MaterialIndex* sharedMaterials=nullptr);
 
 //##################################################################################################
+//! Load the materials from an MTL file and append them to outputMaterials.
+/*!
+\param outputProperties If not null one entry is appended for each material with the values that
+do not fit in a tp_math_utils::Material.
+*/
 bool TP_OBJ_EXPORT parseMTL(const std::string& filePath,
                             std::vector<tp_math_utils::Material>& outputMaterials,
-                            tp_utils::Progress* progress);
+                            tp_utils::Progress* progress,
+                            OBJStats* stats=nullptr,
+                            std::vector<MTLProperties>* outputProperties=nullptr);
 
 
 }
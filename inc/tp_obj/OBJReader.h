@@ -0,0 +1,184 @@
+#pragma once
+
+#include "tp_obj/Globals.h"
+
+#include "glm/glm.hpp"
+
+#include <string_view>
+
+namespace tp_utils
+{
+class Progress;
+}
+
+namespace tp_obj
+{
+struct OBJStats;
+
+//##################################################################################################
+//! A corner of a face, the indexes are 0 based and count every attribute in the file.
+struct OBJCorner
+{
+  size_t vvi{0};     //!< Position index.
+  size_t vti{0};     //!< Texture coordinate index, the same as vvi if the corner does not give one.
+  size_t vni{0};     //!< Normal index, the same as vvi if the corner does not give one.
+  bool valid{false}; //!< False if the corner could not be parsed.
+};
+
+//##################################################################################################
+//! The number of each kind of attribute read so far, negative face indexes count back from these.
+struct OBJAttributeCounts
+{
+  size_t positions{0};
+  size_t texCoords{0};
+  size_t normals{0};
+};
+
+//##################################################################################################
+//! Why a face corner could not be decoded.
+enum class OBJCornerError
+{
+  None,       //!< The corner was decoded.
+  Empty,      //!< There is no position index.
+  Syntax,     //!< An index does not start with digits after an optional sign, or is too long.
+  Zero,       //!< 0 is not a valid index.
+  OutOfRange  //!< A negative index reaches back past the first attribute.
+};
+
+//##################################################################################################
+//! Decode a v, v/vt, v//vn, or v/vt/vn face corner without allocating or throwing.
+/*!
+Indexes are 1 based, negative indexes are relative to the end of the attributes read so far, so -1
+is the last one. Missing tex coord and normal indexes are set to the position index. As with stoull
+anything after the digits of an index is ignored. Positive indexes are not checked against counts,
+that is left to the caller.
+
+\param token the corner, without surrounding whitespace.
+\param counts the number of attributes before the face line.
+\param corner set to the 0 based indexes. valid is false if the position index is bad or if the tex
+coord or normal index is a Syntax error. A tex coord or normal index that is Zero or OutOfRange is
+set to SIZE_MAX so the vert has none and the corner stays valid.
+\returns the first problem found, or None.
+*/
+OBJCornerError TP_OBJ_EXPORT parseOBJCorner(std::string_view token,
+                                            const OBJAttributeCounts& counts,
+                                            OBJCorner& corner);
+
+//##################################################################################################
+//! Flags that select the lines that readOBJText parses and passes on.
+enum OBJContent
+{
+  OBJAttributes        = 1<<0, //!< v, vt, and vn lines.
+  OBJFaces             = 1<<1, //!< f lines.
+  OBJObjects           = 1<<2, //!< o, g, s, and usemtl lines.
+  OBJMaterialLibraries = 1<<3, //!< mtllib lines.
+  OBJAll               = OBJAttributes | OBJFaces | OBJObjects | OBJMaterialLibraries
+};
+
+//##################################################################################################
+//! Receives the contents of an OBJ file in file order as it is parsed.
+/*!
+Nothing is accumulated by the reader, so memory use only depends on what the visitor keeps. All of
+the methods do nothing by default so a visitor only needs to implement what it is interested in.
+*/
+class TP_OBJ_EXPORT OBJVisitor
+{
+public:
+  //################################################################################################
+  virtual ~OBJVisitor();
+
+  //################################################################################################
+  //! Called for each v line.
+  virtual void vertex(const glm::vec3& position);
+
+  //################################################################################################
+  //! Called for each vt line, the y component is already flipped if reverse was requested.
+  virtual void texCoord(const glm::vec2& texCoord);
+
+  //################################################################################################
+  //! Called for each vn line.
+  virtual void normal(const glm::vec3& normal);
+
+  //################################################################################################
+  //! Called for each f line, corners that could not be parsed are passed with valid set to false.
+  /*!
+  Every corner on the line is passed, faces with more than 4 corners are triangulated by the parser.
+  */
+  virtual void face(const std::vector<OBJCorner>& corners);
+
+  //################################################################################################
+  //! Called for each o line.
+  virtual void object(const std::string& name);
+
+  //################################################################################################
+  //! Called for each g line.
+  virtual void group(const std::string& name);
+
+  //################################################################################################
+  //! Called for each s line.
+  virtual void smoothingGroup(const std::string& name);
+
+  //################################################################################################
+  //! Called for each usemtl line.
+  virtual void material(const std::string& name);
+
+  //################################################################################################
+  //! Called for each mtllib line, fileName is relative to the OBJ file.
+  virtual void materialLibrary(const std::string& fileName);
+};
+
+//##################################################################################################
+//! Parse OBJ text and pass its contents to the visitor.
+/*!
+The text must contain complete lines, it can be passed in consecutive blocks by calling this
+repeatedly with the same visitor.
+
+\param text the OBJ text to parse.
+\param reverse flip the y component of texture coordinates.
+\param visitor receives the contents of the text.
+\param exporterVersion set if the text contains an OMI exporter version comment, can be nullptr.
+\param error set to a description of the problem if parsing fails.
+\param content a combination of OBJContent flags, lines of other types are skipped.
+\param stats if not nullptr the line counts and the time spent on each kind of line are added.
+\param progress if not nullptr it is updated as the text is read and checked for cancellation.
+\param counts the number of attributes before the text, used to resolve negative indexes and
+updated as attribute lines are passed, even those skipped by content. Only needed when the text
+does not start at the beginning of the file, if nullptr the counts start at 0.
+\returns false if an attribute line could not be parsed or progress asked to stop, the visitor is
+not called after that.
+*/
+bool TP_OBJ_EXPORT readOBJText(std::string_view text,
+                               bool reverse,
+                               OBJVisitor& visitor,
+                               std::string* exporterVersion,
+                               std::string& error,
+                               int content=OBJAll,
+                               OBJStats* stats=nullptr,
+                               tp_utils::Progress* progress=nullptr,
+                               OBJAttributeCounts* counts=nullptr);
+
+//##################################################################################################
+//! Parse the contents of an OBJ file that may be compressed and pass them to the visitor.
+/*!
+Uncompressed data is passed straight to readOBJText. Compressed data is decompressed in blocks of
+whole lines as it is parsed, see forEachTextBlock, and progress is updated after each block.
+*/
+bool TP_OBJ_EXPORT readOBJData(std::string_view data,
+                               bool reverse,
+                               OBJVisitor& visitor,
+                               std::string* exporterVersion,
+                               std::string& error,
+                               int content=OBJAll,
+                               OBJStats* stats=nullptr,
+                               tp_utils::Progress* progress=nullptr);
+
+//##################################################################################################
+//! Read an OBJ file and pass its contents to the visitor as they are parsed.
+bool TP_OBJ_EXPORT readOBJ(const std::string& filePath,
+                           bool reverse,
+                           OBJVisitor& visitor,
+                           std::string& exporterVersion,
+                           tp_utils::Progress* progress,
+                           OBJStats* stats=nullptr);
+
+}
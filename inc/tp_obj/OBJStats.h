@@ -0,0 +1,89 @@
+#pragma once
+
+#include "tp_obj/Globals.h"
+
+#include <chrono>
+
+namespace tp_obj
+{
+
+//##################################################################################################
+//! Timings and counters filled in while reading and writing OBJ and MTL files.
+/*!
+Values are added to, so a single instance can collect the stats of a load that parses an OBJ file
+and several MTL files. Collecting timings reads the clock for every line so it adds a little
+overhead, only pass a stats object when the numbers are wanted.
+
+When a file is parsed on several threads the phase times are summed across the threads, compare
+them with totalSeconds to see how well the work was spread.
+*/
+struct TP_OBJ_EXPORT OBJStats
+{
+  //-- Timings in seconds --------------------------------------------------------------------------
+  double totalSeconds{0.0};       //!< Wall time of the whole call.
+  double ioSeconds{0.0};          //!< Opening and mapping files, or writing them out.
+  double tokenizeSeconds{0.0};    //!< Splitting lines into tokens, includes reading mapped pages.
+  double attributeSeconds{0.0};   //!< Parsing v, vt, and vn lines.
+  double faceSeconds{0.0};        //!< Parsing f, o, g, s, and usemtl lines and building meshes.
+  double materialSeconds{0.0};    //!< Parsing MTL files and assigning materials to meshes.
+  double serializeSeconds{0.0};   //!< Formatting geometry as text.
+  double weldSeconds{0.0};        //!< Merging verts, see weldVertices.
+  double optimizeSeconds{0.0};    //!< Reordering triangles and verts, see optimizeVertexOrder.
+
+  //-- Counters ------------------------------------------------------------------------------------
+  size_t bytes{0};                //!< Bytes of OBJ and MTL text read or written.
+  size_t lines{0};                //!< Non empty lines read.
+  size_t positions{0};            //!< v lines read or written.
+  size_t texCoords{0};            //!< vt lines read or written.
+  size_t normals{0};              //!< vn lines read or written.
+  size_t faces{0};                //!< f lines read or written.
+  size_t meshes{0};               //!< Geometry3D objects produced or written.
+  size_t materials{0};            //!< Materials read from MTL files.
+  size_t mtlCacheHits{0};         //!< MTL files that were taken from the cache instead of parsed.
+  size_t invalidCorners{0};       //!< Face corners with an index that could not be decoded.
+  size_t cornerLookups{0};        //!< Face corners looked up in the vertex map.
+  size_t cornerHits{0};           //!< Lookups that found an existing vertex.
+  size_t convexPolygons{0};       //!< Faces with more than 4 corners that were split into a fan.
+  size_t concavePolygons{0};      //!< Faces with more than 4 corners that needed ear clipping.
+  size_t weldedVerts{0};          //!< Verts removed by welding.
+  size_t outputVerts{0};          //!< Verts in the output after deduplication.
+  size_t peakTemporaryBytes{0};   //!< Estimated peak of memory used by parser temporaries.
+
+  //################################################################################################
+  //! Fraction of face corners that reused an existing vertex.
+  double dedupHitRate() const
+  {
+    return cornerLookups?double(cornerHits)/double(cornerLookups):0.0;
+  }
+
+  //################################################################################################
+  //! Add the counters and timings of other to this.
+  void add(const OBJStats& other);
+};
+
+//##################################################################################################
+//! Adds the time between construction and destruction to a timing, does nothing if given nullptr.
+class OBJStatsTimer
+{
+public:
+  //################################################################################################
+  OBJStatsTimer(double* seconds):
+    m_seconds(seconds)
+  {
+    if(m_seconds)
+      m_start = std::chrono::steady_clock::now();
+  }
+
+  //################################################################################################
+  ~OBJStatsTimer()
+  {
+    if(m_seconds)
+      *m_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+  }
+
+private:
+  double* m_seconds;
+  std::chrono::steady_clock::time_point m_start;
+};
+
+}
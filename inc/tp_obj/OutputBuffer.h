@@ -0,0 +1,130 @@
+#pragma once
+
+#include "tp_obj/Globals.h"
+
+#include <functional>
+#include <string_view>
+
+namespace tp_obj
+{
+
+//##################################################################################################
+//! Passed as a precision to format floats with the fewest digits that read back to the same value.
+constexpr int shortestPrecision = -1;
+
+//##################################################################################################
+//! A fixed size buffer for formatting text that is passed to a sink each time it fills up.
+/*!
+Numbers are formatted with std::to_chars directly into the buffer so no locale or stream state is
+involved. The buffer is flushed when it is destroyed, call flush() first to check for errors.
+*/
+class TP_OBJ_EXPORT OutputBuffer
+{
+  TP_NONCOPYABLE(OutputBuffer);
+public:
+  //! Called with each block of text, returns false if it could not be written.
+  using Sink = std::function<bool(const char* data, size_t size)>;
+
+  //################################################################################################
+  OutputBuffer(const Sink& sink, size_t capacity=64*1024);
+
+  //################################################################################################
+  ~OutputBuffer();
+
+  //################################################################################################
+  void append(char c)
+  {
+    if(m_size==m_capacity)
+      flush();
+    m_data[m_size++] = c;
+  }
+
+  //################################################################################################
+  void append(std::string_view text);
+
+  //################################################################################################
+  void appendInt(int64_t value);
+
+  //################################################################################################
+  //! Append a float with precision digits after the decimal point, or shortestPrecision.
+  void appendFloat(float value, int precision);
+
+  //################################################################################################
+  //! Pass the buffered text to the sink, returns false if this or any earlier write failed.
+  bool flush();
+
+  //################################################################################################
+  //! Returns false if the sink has failed, later text is discarded.
+  bool ok() const
+  {
+    return m_ok;
+  }
+
+  //################################################################################################
+  //! The number of bytes appended so far, including those still in the buffer.
+  size_t bytesWritten() const
+  {
+    return m_flushed + m_size;
+  }
+
+private:
+  //################################################################################################
+  //! Make sure there is room for at least size bytes.
+  void reserve(size_t size)
+  {
+    if(m_capacity-m_size<size)
+      flush();
+  }
+
+  Sink m_sink;
+  char* m_data;
+  size_t m_capacity;
+  size_t m_size{0};
+  size_t m_flushed{0};
+  bool m_ok{true};
+};
+
+//##################################################################################################
+//! A file opened for writing that is written to through its file descriptor without buffering.
+class TP_OBJ_EXPORT OutputFile
+{
+  TP_NONCOPYABLE(OutputFile);
+public:
+  //################################################################################################
+  //! Create or truncate the file.
+  OutputFile(const std::string& filePath);
+
+  //################################################################################################
+  ~OutputFile();
+
+  //################################################################################################
+  bool isValid() const;
+
+  //################################################################################################
+  //! Write size bytes at the current position in the file and move the position past them.
+  bool write(const char* data, size_t size);
+
+  //################################################################################################
+  //! Write size bytes at position without moving the current position, this is safe to call from
+  //! several threads at once for ranges that do not overlap.
+  bool writeAt(size_t position, const char* data, size_t size);
+
+  //################################################################################################
+  //! Set the size of the file, extending it with zeros.
+  bool resize(size_t size);
+
+  //################################################################################################
+  //! Close the file, returns false if it was not valid or closing failed.
+  bool close();
+
+  //################################################################################################
+  //! Returns a sink for an OutputBuffer that writes to this file.
+  OutputBuffer::Sink sink();
+
+private:
+  struct Private;
+  Private* d;
+  friend struct Private;
+};
+
+}
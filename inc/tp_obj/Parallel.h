@@ -0,0 +1,31 @@
+#pragma once
+
+#include "tp_obj/Globals.h"
+
+#include <functional>
+
+namespace tp_obj
+{
+
+//##################################################################################################
+//! Returns the number of threads to use for a requested count, 0 means use all hardware threads.
+size_t TP_OBJ_EXPORT resolveThreadCount(size_t threadCount);
+
+//##################################################################################################
+//! Call closure for each index in [0, count) spread across threadCount threads.
+/*!
+The calling thread takes part in the work and the function returns once all indexes have been
+processed. Indexes are handed out one at a time so uneven work is balanced between the threads.
+
+The other threads come from a pool that is shared by the whole process and kept between calls, so
+a call does not pay to start threads. It is safe to call this from inside a closure, the nested
+call is helped by any idle threads in the pool and the calling thread does the rest.
+
+If closure throws on any thread no more indexes are handed out, and once the threads working on
+other indexes have finished the first exception is rethrown on the calling thread.
+*/
+void TP_OBJ_EXPORT parallelFor(size_t count,
+                               size_t threadCount,
+                               const std::function<void(size_t)>& closure);
+
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "tp_obj/Globals.h"
+
+#include <memory_resource>
+
+namespace tp_obj
+{
+struct OBJStats;
+struct MaterialIndex;
+struct WeldTolerances;
+
+//##################################################################################################
+//! Options that control how OBJ files are read.
+struct TP_OBJ_EXPORT ParseOptions
+{
+  //! The number of threads used to parse a file, 0 uses all hardware threads. Files smaller than
+  //! parallelThreshold are always parsed on the calling thread.
+  size_t threadCount{1};
+
+  //! The file size in bytes above which a file is split into chunks and parsed on several threads.
+  size_t parallelThreshold{8*1024*1024};
+
+  //! Used by readOBJFile to keep the parsed geometry in a binary cache file, later loads read the
+  //! cache instead of parsing if the OBJ file, its MTL files, and the parameters are unchanged.
+  bool useCache{false};
+
+  //! Where to keep cache files, if empty they are written next to the OBJ file.
+  std::string cacheDirectory;
+
+  //! Parse the MTL files named at the start of the OBJ file on another thread while the geometry is
+  //! parsed, see MaterialPrefetch. This starts a thread and maps the OBJ file a second time, so it
+  //! only pays off for files with large MTL files.
+  bool prefetchMaterials{false};
+
+  //! If not nullptr verts within these tolerances of each other are merged once a file is parsed,
+  //! see weldVertices. The meshes are spread across threadCount threads.
+  const WeldTolerances* weld{nullptr};
+
+  //! Reorder the triangles and verts of each mesh for the GPU vertex cache once it is parsed, see
+  //! optimizeVertexOrder. This runs after welding.
+  bool optimizeVertexOrder{false};
+
+  //! If not nullptr timings and counters for the load are added to this, see OBJStats.
+  OBJStats* stats{nullptr};
+
+  //! If not nullptr the materials are added to this index instead of being copied into each mesh.
+  //! The meshes only have the name of their material set, look the material up with
+  //! MaterialIndex::find. The index can be shared between loads.
+  MaterialIndex* sharedMaterials{nullptr};
+
+  //! Temporaries of a parse, such as the attributes and the tables used to build meshes, are
+  //! allocated from an arena that is released in one go when the parse finishes. The arena takes
+  //! its blocks from this resource, nullptr uses std::pmr::get_default_resource(). When a file is
+  //! parsed on several threads each thread has its own arena, so the resource must be thread safe.
+  std::pmr::memory_resource* memoryResource{nullptr};
+
+  //! If not nullptr the description of an error that stops the load is stored here as well as
+  //! being passed to the progress.
+  std::string* error{nullptr};
+};
+
+}
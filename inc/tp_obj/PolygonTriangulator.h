@@ -0,0 +1,55 @@
+#pragma once
+
+#include "tp_obj/Globals.h"
+
+#include "glm/glm.hpp"
+
+#include <memory_resource>
+
+namespace tp_obj
+{
+
+//##################################################################################################
+//! Splits polygons into triangles, the buffers are kept between calls so it does not allocate.
+/*!
+The polygon is projected onto the axis aligned plane that its normal is closest to. Convex polygons
+are split into a fan, concave ones are split by ear clipping. Polygons that cross themselves or
+have no area can't be clipped completely, whatever is left of them is split into a fan.
+*/
+class TP_OBJ_EXPORT PolygonTriangulator
+{
+public:
+  //################################################################################################
+  //! \param resource where the buffers are allocated from.
+  PolygonTriangulator(std::pmr::memory_resource* resource=std::pmr::get_default_resource());
+
+  //################################################################################################
+  //! Triangulate a polygon with count points, the result is available from triangles().
+  /*!
+  \returns true if the polygon was convex and a fan was used.
+  */
+  bool triangulate(const glm::vec3* points, size_t count);
+
+  //################################################################################################
+  //! Indexes into the points of the last polygon, 3 for each triangle, wound the same way as it.
+  const std::pmr::vector<size_t>& triangles() const
+  {
+    return m_triangles;
+  }
+
+private:
+  //################################################################################################
+  bool isConvex(int orientation) const;
+
+  //################################################################################################
+  void clipEars(int orientation);
+
+  //################################################################################################
+  void addFan(const size_t* polygon, size_t count);
+
+  std::pmr::vector<glm::vec2> m_points;
+  std::pmr::vector<size_t> m_remaining;
+  std::pmr::vector<size_t> m_triangles;
+};
+
+}
@@ -1,6 +1,10 @@
 #pragma once
 
 #include "tp_obj/Globals.h"
+#include "tp_obj/ParseOptions.h"
+#include "tp_obj/OBJStats.h"
+#include "tp_obj/OBJIndex.h"
+#include "tp_obj/OBJMeshBuffers.h"
 
 #include "tp_math_utils/Geometry3D.h"
 
@@ -25,7 +29,89 @@ bool TP_OBJ_EXPORT readOBJFile(const std::string& filePath,
                                bool reverse,
                                std::string& exporterVersion,
                                std::vector<tp_math_utils::Geometry3D>& outputGeometry,
-                               tp_utils::Progress* progress);
+                               tp_utils::Progress* progress,
+                               const ParseOptions& options=ParseOptions());
+
+//##################################################################################################
+//! Load an OBJ file straight into vertex and index buffers, see OBJMeshBuffers.
+/*!
+This skips building a Geometry3D for each object, so the verts are only held once. Anything already
+in outputBuffers is replaced, only its layout is kept. The faces are always written as a list of
+triangles.
+
+The OBJ cache holds Geometry3D objects so options.useCache is ignored.
+*/
+bool TP_OBJ_EXPORT readOBJFile(const std::string& filePath,
+                               bool reverse,
+                               std::string& exporterVersion,
+                               OBJMeshBuffers& outputBuffers,
+                               tp_utils::Progress* progress,
+                               const ParseOptions& options=ParseOptions());
+
+//##################################################################################################
+//! Returns true for the sections of a file that should be loaded by readOBJSections.
+using OBJSectionFilter = std::function<bool(const OBJSection&)>;
+
+//##################################################################################################
+//! Returns a filter that selects sections whose object or group name is in names.
+OBJSectionFilter TP_OBJ_EXPORT objNameFilter(const std::vector<std::string>& names);
+
+//##################################################################################################
+//! Load only the objects of an OBJ file that pass a filter.
+/*!
+The file is indexed first, see OBJIndex, then only the selected sections and the attributes that
+they reference are parsed. If options.useCache is set the index is kept in a file alongside the
+cache file so later loads skip straight to the selected objects. Lines that are not parsed are not
+checked, so errors in them are not reported.
+
+Compressed files can't be read from an offset so they are decompressed into memory before being
+indexed, and their index is not kept.
+*/
+bool TP_OBJ_EXPORT readOBJSections(const std::string& filePath,
+                                   int triangleFan,
+                                   int triangleStrip,
+                                   int triangles,
+                                   bool reverse,
+                                   const OBJSectionFilter& filter,
+                                   std::string& exporterVersion,
+                                   std::vector<tp_math_utils::Geometry3D>& outputGeometry,
+                                   tp_utils::Progress* progress,
+                                   const ParseOptions& options=ParseOptions());
+
+//##################################################################################################
+//! The result of loading one file with readOBJFiles.
+struct TP_OBJ_EXPORT OBJBatchResult
+{
+  std::string filePath;
+  bool ok{false};
+  std::string error;            //!< Why the load failed if ok is false.
+  std::string exporterVersion;
+  std::vector<tp_math_utils::Geometry3D> geometry;
+  OBJStats stats;               //!< Only filled in if options.stats is not nullptr.
+};
+
+//##################################################################################################
+//! Load several OBJ files at once with readOBJFile.
+/*!
+The files are handed out to options.threadCount threads one at a time, largest first, so that a
+few big files don't hold up the rest. Each file is parsed on a single thread as the files already
+keep the threads busy. MTL files shared by several OBJ files are parsed once through the MTL cache.
+
+Progress is updated as each file finishes and the error of each failed file is added to it, the
+remaining files are skipped if it asks to stop. A file whose load throws fails with the message of
+the exception as its error. If options.stats is set the stats of all of the
+files are added to it and if options.sharedMaterials is set the materials of all of the files are
+added to it.
+
+\returns one result for each path in the same order as filePaths.
+*/
+std::vector<OBJBatchResult> TP_OBJ_EXPORT readOBJFiles(const std::vector<std::string>& filePaths,
+                                                       int triangleFan,
+                                                       int triangleStrip,
+                                                       int triangles,
+                                                       bool reverse,
+                                                       tp_utils::Progress* progress,
+                                                       const ParseOptions& options=ParseOptions());
 
 //##################################################################################################
 std::string TP_OBJ_EXPORT getAssociatedFilePath(const std::string& objFilePath,
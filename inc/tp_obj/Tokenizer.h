@@ -0,0 +1,80 @@
+#pragma once
+
+#include "tp_obj/Globals.h"
+
+#include <string_view>
+
+namespace tp_obj
+{
+
+//##################################################################################################
+//! Read only view of the contents of a file.
+/*!
+The file is memory mapped on platforms that support it, else it is read into memory. An empty or
+missing file results in an empty view.
+*/
+class TP_OBJ_EXPORT MappedFile
+{
+  TP_NONCOPYABLE(MappedFile);
+public:
+  //################################################################################################
+  MappedFile(const std::string& filePath);
+
+  //################################################################################################
+  ~MappedFile();
+
+  //################################################################################################
+  //! Returns true if the file was opened, an empty file is still valid.
+  bool isValid() const;
+
+  //################################################################################################
+  std::string_view text() const;
+
+private:
+  struct Private;
+  Private* d;
+  friend struct Private;
+};
+
+//##################################################################################################
+//! Split text into lines of whitespace separated tokens without copying it.
+/*!
+This follows the rules of the OBJ and MTL formats, everything after a '#' is a comment and empty
+lines are skipped. The tokens are views into the text so the text must outlive the tokenizer.
+*/
+class TP_OBJ_EXPORT LineTokenizer
+{
+public:
+  //################################################################################################
+  LineTokenizer(std::string_view text, std::string* exporterVersion=nullptr);
+
+  //################################################################################################
+  //! Move to the next line that contains tokens, returns false at the end of the text.
+  bool next();
+
+  //################################################################################################
+  //! The tokens of the current line, this is never empty after next() returns true.
+  const std::vector<std::string_view>& parts() const
+  {
+    return m_parts;
+  }
+
+  //################################################################################################
+  //! The byte offset of the start of the next line.
+  size_t position() const
+  {
+    return m_position;
+  }
+
+private:
+  std::string_view m_text;
+  std::string* m_exporterVersion;
+  size_t m_position{0};
+  std::vector<std::string_view> m_parts;
+};
+
+//##################################################################################################
+//! Join all but the first token with single spaces, used to read names.
+std::string TP_OBJ_EXPORT joinName(const std::vector<std::string_view>& parts);
+
+}
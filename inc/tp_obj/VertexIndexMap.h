@@ -0,0 +1,112 @@
+#pragma once
+
+#include "tp_obj/Globals.h"
+
+#include <memory_resource>
+
+namespace tp_obj
+{
+
+//##################################################################################################
+//! Maps the v/vt/vn index triplets of OBJ face corners to vertex indexes in the output mesh.
+/*!
+This is an open addressing hash table with linear probing. Corners where all three indexes are the
+same, which is what most exporters write, are stored in a directly indexed table instead. The direct
+table is indexed relative to the first such corner of the object and only covers a window that is a
+few times the number of entries in it, so objects late in a large file don't get a table sized by
+every vertex before them. Corners outside of the window go in the hash table.
+
+Entries are tagged with a generation so clear() is constant time and the storage is reused by the
+next object in the file rather than being freed and allocated again.
+*/
+class TP_OBJ_EXPORT VertexIndexMap
+{
+public:
+  //################################################################################################
+  //! \param resource where the tables are allocated from.
+  VertexIndexMap(std::pmr::memory_resource* resource=std::pmr::get_default_resource());
+
+  //################################################################################################
+  //! Remove all entries, the storage is kept for reuse.
+  void clear();
+
+  //################################################################################################
+  //! Returns the vertex index for the triplet, or -1 if it has not been inserted.
+  int find(size_t vvi, size_t vti, size_t vni) const
+  {
+    if(vvi==vti && vvi==vni && m_directSize>0 && vvi>=m_directBase)
+    {
+      if(size_t d=vvi-m_directBase; d<m_direct.size() && m_direct[d].generation==m_generation)
+        return m_direct[d].index;
+    }
+
+    if(m_size==0)
+      return -1;
+
+    for(size_t s=hash(vvi, vti, vni)&m_mask;; s=(s+1)&m_mask)
+    {
+      const Slot& slot = m_slots[s];
+      if(slot.generation!=m_generation)
+        return -1;
+
+      if(slot.vvi==vvi && slot.vti==vti && slot.vni==vni)
+        return slot.index;
+    }
+  }
+
+  //################################################################################################
+  //! Add a triplet that is not already in the map.
+  void insert(size_t vvi, size_t vti, size_t vni, int index);
+
+  //################################################################################################
+  //! Bytes allocated by the tables.
+  size_t memoryUsage() const
+  {
+    return m_slots.capacity()*sizeof(Slot) + m_direct.capacity()*sizeof(DirectSlot);
+  }
+
+private:
+  //################################################################################################
+  static size_t hash(uint64_t vvi, uint64_t vti, uint64_t vni)
+  {
+    uint64_t h = (vvi*0x9E3779B97F4A7C15ull) ^ (vti*0xC2B2AE3D27D4EB4Full) ^ (vni*0x165667B19E3779F9ull);
+    return size_t(h ^ (h>>29));
+  }
+
+  //################################################################################################
+  void grow();
+
+  //################################################################################################
+  void resetGenerations();
+
+  //! The direct table always covers at least this many indexes past its base.
+  static constexpr size_t minDirectWindow = 1024;
+
+  //! The direct table covers this many indexes for each entry in it.
+  static constexpr size_t directWindowFactor = 4;
+
+  struct Slot
+  {
+    uint64_t vvi;
+    uint64_t vti;
+    uint64_t vni;
+    uint32_t generation;
+    int index;
+  };
+
+  struct DirectSlot
+  {
+    uint32_t generation{0};
+    int index{-1};
+  };
+
+  std::pmr::vector<Slot> m_slots;
+  std::pmr::vector<DirectSlot> m_direct;
+  size_t m_mask{0};
+  size_t m_size{0};
+  size_t m_directBase{0};  //!< The vvi of m_direct[0], set by the first direct insert after clear().
+  size_t m_directSize{0};
+  uint32_t m_generation{1};
+};
+
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "tp_obj/Globals.h"
+
+#include "tp_math_utils/Geometry3D.h"
+
+namespace tp_obj
+{
+struct OBJMeshBuffers;
+
+//##################################################################################################
+//! Reorder the triangles and verts of a mesh so that it renders faster.
+/*!
+The triangles of each list are reordered with Tipsify (Sander, Nehab, and Barczak 2007) so that
+triangles that share verts are drawn close together and hit the post transform vertex cache. The
+verts are then reordered by first use, and the indexes remapped, so that vertex fetch reads memory
+in order. The winding of each triangle is kept.
+
+Only index lists with the triangles type of the mesh are reordered. Verts that no triangle uses are
+moved to the end.
+
+\param cacheSize the number of verts the vertex cache is assumed to hold.
+*/
+void TP_OBJ_EXPORT optimizeVertexOrder(tp_math_utils::Geometry3D& geometry, size_t cacheSize=16);
+
+//##################################################################################################
+//! Reorder each mesh as above, the meshes are spread across threadCount threads.
+void TP_OBJ_EXPORT optimizeVertexOrder(std::vector<tp_math_utils::Geometry3D>& geometry,
+                                       size_t threadCount=1,
+                                       size_t cacheSize=16);
+
+//##################################################################################################
+//! Reorder the triangles of each submesh and the verts of each object in a set of buffers.
+//! Nothing is done if the layout of the buffers is not valid.
+void TP_OBJ_EXPORT optimizeVertexOrder(OBJMeshBuffers& buffers,
+                                       size_t threadCount=1,
+                                       size_t cacheSize=16);
+
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "tp_obj/Globals.h"
+
+#include "tp_math_utils/Geometry3D.h"
+
+namespace tp_obj
+{
+struct OBJMeshBuffers;
+
+//##################################################################################################
+//! How close two verts must be to be merged by weldVertices.
+/*!
+Each attribute is compared by the distance between the two values, a tolerance of 0 only merges
+verts with exactly the same value.
+*/
+struct TP_OBJ_EXPORT WeldTolerances
+{
+  float position{1e-5f};
+  float texCoord{1e-5f};
+  float normal{1e-3f};
+};
+
+//##################################################################################################
+//! Merge the verts of a mesh whose position, tex coord, and normal are within the tolerances.
+/*!
+OBJ files reference attributes by index so verts are only shared by faces that use the same v, vt,
+and vn indexes, many exporters write the attributes of each face separately. This finds verts that
+are close enough to be the same with a hash grid of the positions, so it takes linear time.
+
+Each vert is merged into the first vert before it that it is close enough to, the verts that are
+kept stay in the same order. Indexes are remapped and triangles that lose a corner are removed from
+the index lists with the triangles type of the mesh.
+
+\returns the number of verts that were removed.
+*/
+size_t TP_OBJ_EXPORT weldVertices(tp_math_utils::Geometry3D& geometry,
+                                  const WeldTolerances& tolerances=WeldTolerances());
+
+//##################################################################################################
+//! Weld each mesh as above, the meshes are spread across threadCount threads.
+size_t TP_OBJ_EXPORT weldVertices(std::vector<tp_math_utils::Geometry3D>& geometry,
+                                  const WeldTolerances& tolerances=WeldTolerances(),
+                                  size_t threadCount=1);
+
+//##################################################################################################
+//! Weld the verts of each object in a set of buffers, the vertex arrays are compacted afterwards.
+//! Nothing is done if the layout of the buffers is not valid.
+size_t TP_OBJ_EXPORT weldVertices(OBJMeshBuffers& buffers,
+                                  const WeldTolerances& tolerances=WeldTolerances(),
+                                  size_t threadCount=1);
+
+}
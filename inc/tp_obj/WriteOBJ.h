@@ -2,6 +2,7 @@
 #define tp_obj_WriteOBJ_h
 
 #include "tp_obj/Globals.h" // IWYU pragma: keep
+#include "tp_obj/WriteOptions.h"
 
 #include "tp_math_utils/Geometry3D.h"
 
@@ -12,22 +13,38 @@ namespace tp_obj
 std::string serializeMTL(const std::vector<tp_math_utils::Geometry3D>& geometry);
 
 //##################################################################################################
+//! Format geometry as OBJ text into output.
+void serializeOBJ(OutputBuffer& output,
+                  const std::vector<tp_math_utils::Geometry3D>& geometry,
+                  const std::string& mtlName,
+                  const WriteOptions& options=WriteOptions());
+
+//##################################################################################################
+//! Format geometry as OBJ text, prefer writeOBJ for large files as this holds all of the text.
 std::string serializeOBJ(const std::vector<tp_math_utils::Geometry3D>& geometry,
-                         const std::string& mtlName);
+                         const std::string& mtlName,
+                         const WriteOptions& options=WriteOptions());
 
 //##################################################################################################
-void writeOBJ(const std::string& filename,
+//! Write geometry to an OBJ file, the text is formatted in blocks and written as it is produced.
+bool writeOBJ(const std::string& filename,
               const std::vector<tp_math_utils::Geometry3D>& geometry,
-              const std::string& mtlName);
+              const std::string& mtlName,
+              const WriteOptions& options=WriteOptions());
 
 //##################################################################################################
-void writeOBJ(const std::string& path,
+//! Write name.obj and name.mtl to path, the compression extension is added if compressing.
+//! Returns false if either file could not be written.
+bool writeOBJ(const std::string& path,
               const std::string& name,
-              const std::vector<tp_math_utils::Geometry3D>& geometry);
+              const std::vector<tp_math_utils::Geometry3D>& geometry,
+              const WriteOptions& options=WriteOptions());
 
 //##################################################################################################
-void writeMTL(const std::string& filename,
-              const std::vector<tp_math_utils::Geometry3D>& geometry);
+//! Write the materials of geometry to an MTL file, returns false if it could not be written.
+bool writeMTL(const std::string& filename,
+              const std::vector<tp_math_utils::Geometry3D>& geometry,
+              const WriteOptions& options=WriteOptions());
 
 }
 
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "tp_obj/Compression.h"
+
+#include <memory_resource>
+
+namespace tp_obj
+{
+struct OBJStats;
+
+//##################################################################################################
+//! Options that control how OBJ files are written.
+struct TP_OBJ_EXPORT WriteOptions
+{
+  //! Digits written after the decimal point, or shortestPrecision to write the fewest digits that
+  //! read back to exactly the same float. Shortest round trip output is usually smaller as well.
+  int precision{6};
+
+  //! Write each unique position, tex coord, and normal once and give faces separate v/vt/vn
+  //! indexes. Meshes where every tex coord or normal has the default value of Vertex3D do not
+  //! reference them. Values are compared by their bits so the geometry read back is unchanged.
+  bool deduplicate{false};
+
+  //! The number of threads used to format the text, 0 uses all hardware threads. Meshes are split
+  //! into blocks that are formatted separately and then written in order. Deduplicated output is
+  //! always formatted on the calling thread.
+  size_t threadCount{1};
+
+  //! Compress the files written by writeOBJ and writeMTL, see Compression. The text is still
+  //! formatted on threadCount threads but is compressed on the calling thread.
+  Compression compression{Compression::None};
+
+  //! The compression level, -1 uses the default of the format.
+  int compressionLevel{-1};
+
+  //! Where the buffers of formatted text and the tables used to deduplicate values are allocated
+  //! from, nullptr uses std::pmr::get_default_resource(). Formatting threads allocate from it at
+  //! the same time so it must be thread safe if threadCount is more than 1.
+  std::pmr::memory_resource* memoryResource{nullptr};
+
+  //! If not nullptr timings and counters for the write are added to this, see OBJStats.
+  OBJStats* stats{nullptr};
+};
+
+}
@@ -0,0 +1,143 @@
+#include "tp_obj/BinaryFile.h"
+#include "tp_obj/FileStamp.h"
+
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <random>
+#include <thread>
+
+namespace tp_obj
+{
+
+//##################################################################################################
+BinaryWriter::BinaryWriter(const std::string& path):
+  m_stream(path, std::ios::binary | std::ios::trunc)
+{
+
+}
+
+//##################################################################################################
+void BinaryWriter::writeString(const std::string& value)
+{
+  write(uint64_t(value.size()));
+  m_stream.write(value.data(), std::streamsize(value.size()));
+}
+
+//##################################################################################################
+void BinaryWriter::writeStamp(const FileStamp& stamp)
+{
+  write(uint8_t(stamp.exists));
+  write(stamp.size);
+  write(stamp.modified);
+}
+
+//##################################################################################################
+bool BinaryWriter::close()
+{
+  m_stream.close();
+  return !m_stream.fail();
+}
+
+//##################################################################################################
+BinaryReader::BinaryReader(std::string_view data):
+  m_data(data)
+{
+
+}
+
+//##################################################################################################
+bool BinaryReader::readString(std::string& value)
+{
+  uint64_t size=0;
+  if(!read(size) || m_data.size()-m_position<size)
+    return false;
+
+  value.assign(m_data.data()+m_position, size_t(size));
+  m_position += size_t(size);
+  return true;
+}
+
+//##################################################################################################
+bool BinaryReader::readStamp(FileStamp& stamp)
+{
+  uint8_t exists=0;
+  if(!read(exists) || !read(stamp.size) || !read(stamp.modified))
+    return false;
+
+  stamp.exists = exists;
+  return true;
+}
+
+namespace
+{
+
+//##################################################################################################
+//! A temporary path next to path that no other thread or process is writing.
+std::string temporaryPath(const std::string& path)
+{
+  // The random number separates processes, the thread and counter separate writes in this one.
+  static const uint64_t processKey = (uint64_t(std::random_device()())<<32) ^ uint64_t(std::random_device()());
+  static std::atomic<uint64_t> counter{0};
+
+  uint64_t threadKey = std::hash<std::thread::id>()(std::this_thread::get_id());
+
+  char suffix[64];
+  std::snprintf(suffix, sizeof(suffix), ".%016llx.%llx.%llx.tmp",
+           (unsigned long long)processKey,
+           (unsigned long long)threadKey,
+           (unsigned long long)counter++);
+  return path + suffix;
+}
+
+}
+
+//##################################################################################################
+bool writeBinaryFile(const std::string& path,
+                     const std::function<void(BinaryWriter&)>& closure)
+{
+  std::string tmpPath = temporaryPath(path);
+
+  bool written=false;
+  try
+  {
+    BinaryWriter writer(tmpPath);
+    closure(writer);
+    written = writer.close();
+  }
+  catch(...)
+  {
+    // The writer has been destroyed, closing the file, before this runs.
+    std::error_code ec;
+    std::filesystem::remove(tmpPath, ec);
+    throw;
+  }
+
+  if(!written)
+  {
+    std::error_code ec;
+    std::filesystem::remove(tmpPath, ec);
+    return false;
+  }
+
+  std::error_code ec;
+  std::filesystem::rename(tmpPath, path, ec);
+  if(ec)
+  {
+    std::filesystem::remove(tmpPath, ec);
+    return false;
+  }
+
+  return true;
+}
+
+//##################################################################################################
+std::string absolutePath(const std::string& path)
+{
+  std::error_code ec;
+  auto absolute = std::filesystem::absolute(path, ec);
+  return ec?path:absolute.string();
+}
+
+}
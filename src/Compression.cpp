@@ -0,0 +1,500 @@
+#include "tp_obj/Compression.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#ifdef TP_OBJ_ZLIB
+#  include <zlib.h>
+#endif
+
+#ifdef TP_OBJ_ZSTD
+#  include <zstd.h>
+#endif
+
+namespace tp_obj
+{
+
+namespace
+{
+
+//##################################################################################################
+// Size of the blocks of compressed output passed to the sink.
+constexpr size_t compressedBlockSize = 64*1024;
+
+//##################################################################################################
+std::string notSupported(Compression compression)
+{
+  return (compression==Compression::Gzip?std::string("gzip"):std::string("zstd")) +
+      " support was not enabled when tp_obj was built.";
+}
+
+//##################################################################################################
+class Decoder
+{
+public:
+  //################################################################################################
+  virtual ~Decoder()=default;
+
+  //################################################################################################
+  //! Decompress from the start of input into output, advancing both past what was used.
+  virtual bool decode(std::string_view& input, char*& output, char* outputEnd, std::string& error)=0;
+
+  //################################################################################################
+  //! Returns true if the data passed so far ends at the end of a compressed stream.
+  virtual bool complete() const=0;
+};
+
+#ifdef TP_OBJ_ZLIB
+//##################################################################################################
+class GzipDecoder : public Decoder
+{
+public:
+  //################################################################################################
+  GzipDecoder()
+  {
+    // 32 detects the gzip or zlib header.
+    m_valid = inflateInit2(&m_stream, 15+32) == Z_OK;
+  }
+
+  //################################################################################################
+  ~GzipDecoder() override
+  {
+    if(m_valid)
+      inflateEnd(&m_stream);
+  }
+
+  //################################################################################################
+  bool decode(std::string_view& input, char*& output, char* outputEnd, std::string& error) override
+  {
+    if(!m_valid)
+    {
+      error = "Failed to initialize zlib.";
+      return false;
+    }
+
+    m_stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+    m_stream.avail_in = uInt(std::min(input.size(), size_t(UINT_MAX)));
+    m_stream.next_out = reinterpret_cast<Bytef*>(output);
+    m_stream.avail_out = uInt(std::min(size_t(outputEnd-output), size_t(UINT_MAX)));
+
+    int result = inflate(&m_stream, Z_NO_FLUSH);
+
+    size_t consumed = size_t(reinterpret_cast<const char*>(m_stream.next_in) - input.data());
+    input.remove_prefix(consumed);
+    output = reinterpret_cast<char*>(m_stream.next_out);
+
+    if(result == Z_STREAM_END)
+    {
+      // gzip files can contain several members one after the other.
+      m_complete = true;
+      inflateReset(&m_stream);
+      return true;
+    }
+
+    if(result == Z_OK || result == Z_BUF_ERROR)
+    {
+      if(consumed>0)
+        m_complete = false;
+      return true;
+    }
+
+    error = std::string("gzip: ") + (m_stream.msg?m_stream.msg:"invalid data.");
+    return false;
+  }
+
+  //################################################################################################
+  bool complete() const override
+  {
+    return m_complete;
+  }
+
+private:
+  z_stream m_stream{};
+  bool m_valid{false};
+  bool m_complete{false};
+};
+#endif
+
+#ifdef TP_OBJ_ZSTD
+//##################################################################################################
+class ZstdDecoder : public Decoder
+{
+public:
+  //################################################################################################
+  ZstdDecoder():
+    m_stream(ZSTD_createDStream())
+  {
+    if(m_stream)
+      ZSTD_initDStream(m_stream);
+  }
+
+  //################################################################################################
+  ~ZstdDecoder() override
+  {
+    ZSTD_freeDStream(m_stream);
+  }
+
+  //################################################################################################
+  bool decode(std::string_view& input, char*& output, char* outputEnd, std::string& error) override
+  {
+    if(!m_stream)
+    {
+      error = "Failed to initialize zstd.";
+      return false;
+    }
+
+    ZSTD_inBuffer in{input.data(), input.size(), 0};
+    ZSTD_outBuffer out{output, size_t(outputEnd-output), 0};
+
+    size_t result = ZSTD_decompressStream(m_stream, &out, &in);
+    if(ZSTD_isError(result))
+    {
+      error = std::string("zstd: ") + ZSTD_getErrorName(result);
+      return false;
+    }
+
+    input.remove_prefix(in.pos);
+    output += out.pos;
+
+    // 0 means a frame was completely decoded and flushed.
+    if(in.pos>0 || out.pos>0)
+      m_complete = (result == 0);
+    return true;
+  }
+
+  //################################################################################################
+  bool complete() const override
+  {
+    return m_complete;
+  }
+
+private:
+  ZSTD_DStream* m_stream;
+  bool m_complete{false};
+};
+#endif
+
+//##################################################################################################
+std::unique_ptr<Decoder> makeDecoder(Compression compression, std::string& error)
+{
+  switch(compression)
+  {
+  case Compression::None:
+    break;
+
+  case Compression::Gzip:
+#ifdef TP_OBJ_ZLIB
+    return std::make_unique<GzipDecoder>();
+#else
+    break;
+#endif
+
+  case Compression::Zstd:
+#ifdef TP_OBJ_ZSTD
+    return std::make_unique<ZstdDecoder>();
+#else
+    break;
+#endif
+  }
+
+  error = notSupported(compression);
+  return nullptr;
+}
+
+}
+
+//##################################################################################################
+Compression detectCompression(std::string_view data)
+{
+  if(data.size()>=2 && data[0]=='\x1f' && data[1]=='\x8b')
+    return Compression::Gzip;
+
+  if(data.size()>=4 && data[0]=='\x28' && data[1]=='\xb5' && data[2]=='\x2f' && data[3]=='\xfd')
+    return Compression::Zstd;
+
+  return Compression::None;
+}
+
+//##################################################################################################
+bool compressionSupported(Compression compression)
+{
+  switch(compression)
+  {
+  case Compression::None: return true;
+#ifdef TP_OBJ_ZLIB
+  case Compression::Gzip: return true;
+#endif
+#ifdef TP_OBJ_ZSTD
+  case Compression::Zstd: return true;
+#endif
+  default: return false;
+  }
+}
+
+//##################################################################################################
+std::string compressionExtension(Compression compression)
+{
+  switch(compression)
+  {
+  case Compression::None: return std::string();
+  case Compression::Gzip: return ".gz";
+  case Compression::Zstd: return ".zst";
+  }
+  return std::string();
+}
+
+//##################################################################################################
+bool forEachTextBlock(std::string_view data,
+                      const std::function<bool(std::string_view text, float fraction)>& closure,
+                      std::string& error,
+                      size_t blockSize)
+{
+  Compression compression = detectCompression(data);
+  if(compression == Compression::None)
+    return closure(data, 1.0f);
+
+  auto decoder = makeDecoder(compression, error);
+  if(!decoder)
+    return false;
+
+  std::string_view input = data;
+  std::vector<char> buffer(std::max(blockSize, size_t(1024)));
+  size_t used=0;
+
+  for(;;)
+  {
+    // Fill the buffer, zlib can still have output pending after it has consumed all of the input.
+    bool finished=false;
+    while(used<buffer.size())
+    {
+      char* output = buffer.data()+used;
+      size_t inputSize = input.size();
+      if(!decoder->decode(input, output, buffer.data()+buffer.size(), error))
+        return false;
+
+      size_t produced = size_t(output - (buffer.data()+used));
+      used += produced;
+
+      if(produced==0 && input.size()==inputSize)
+      {
+        finished = true;
+        break;
+      }
+    }
+
+    float fraction = float(data.size()-input.size()) / float(data.size());
+
+    if(finished)
+    {
+      if(!input.empty() || !decoder->complete())
+      {
+        error = "Compressed data is truncated.";
+        return false;
+      }
+
+      return used==0 || closure(std::string_view(buffer.data(), used), fraction);
+    }
+
+    // Pass on the complete lines and keep the partial last line for the next block.
+    auto end = std::find(std::make_reverse_iterator(buffer.begin()+std::ptrdiff_t(used)), buffer.rend(), '\n');
+    if(end == buffer.rend())
+    {
+      buffer.resize(buffer.size()*2);
+      continue;
+    }
+
+    size_t blockEnd = size_t(end.base() - buffer.begin());
+    if(!closure(std::string_view(buffer.data(), blockEnd), fraction))
+      return false;
+
+    used -= blockEnd;
+    std::memmove(buffer.data(), buffer.data()+blockEnd, used);
+  }
+}
+
+//##################################################################################################
+struct Compressor::Private
+{
+  Compression compression;
+  OutputBuffer::Sink sink;
+  bool valid{false};
+  bool finished{false};
+  std::vector<char> output = std::vector<char>(compressedBlockSize);
+
+#ifdef TP_OBJ_ZLIB
+  z_stream gzip{};
+#endif
+
+#ifdef TP_OBJ_ZSTD
+  ZSTD_CCtx* zstd{nullptr};
+#endif
+
+  //################################################################################################
+  Private(Compression compression_, const OutputBuffer::Sink& sink_):
+    compression(compression_),
+    sink(sink_)
+  {
+
+  }
+
+  //################################################################################################
+  bool compress(const char* data, size_t size, bool end)
+  {
+    TP_UNUSED(end);
+
+    switch(compression)
+    {
+    case Compression::None:
+      return size==0 || sink(data, size);
+
+    case Compression::Gzip:
+    {
+#ifdef TP_OBJ_ZLIB
+      gzip.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+      gzip.avail_in = uInt(size);
+
+      for(;;)
+      {
+        gzip.next_out = reinterpret_cast<Bytef*>(output.data());
+        gzip.avail_out = uInt(output.size());
+
+        int result = deflate(&gzip, end?Z_FINISH:Z_NO_FLUSH);
+        if(result == Z_STREAM_ERROR)
+          return false;
+
+        size_t produced = output.size() - gzip.avail_out;
+        if(produced>0 && !sink(output.data(), produced))
+          return false;
+
+        if(end?(result == Z_STREAM_END):(gzip.avail_in==0 && gzip.avail_out>0))
+          return true;
+      }
+#else
+      return false;
+#endif
+    }
+
+    case Compression::Zstd:
+    {
+#ifdef TP_OBJ_ZSTD
+      ZSTD_inBuffer in{data, size, 0};
+
+      for(;;)
+      {
+        ZSTD_outBuffer out{output.data(), output.size(), 0};
+
+        size_t remaining = ZSTD_compressStream2(zstd, &out, &in, end?ZSTD_e_end:ZSTD_e_continue);
+        if(ZSTD_isError(remaining))
+          return false;
+
+        if(out.pos>0 && !sink(output.data(), out.pos))
+          return false;
+
+        if(end?(remaining==0):(in.pos==in.size))
+          return true;
+      }
+#else
+      return false;
+#endif
+    }
+    }
+
+    return false;
+  }
+};
+
+//##################################################################################################
+Compressor::Compressor(Compression compression, const OutputBuffer::Sink& sink, int level):
+  d(new Private(compression, sink))
+{
+  switch(compression)
+  {
+  case Compression::None:
+    d->valid = true;
+    break;
+
+  case Compression::Gzip:
+#ifdef TP_OBJ_ZLIB
+    // 16 writes a gzip header rather than a zlib one.
+    d->valid = deflateInit2(&d->gzip, level<0?Z_DEFAULT_COMPRESSION:level, Z_DEFLATED, 15+16, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+#endif
+    break;
+
+  case Compression::Zstd:
+#ifdef TP_OBJ_ZSTD
+    d->zstd = ZSTD_createCCtx();
+    d->valid = d->zstd != nullptr;
+    if(d->valid && level>=0)
+      ZSTD_CCtx_setParameter(d->zstd, ZSTD_c_compressionLevel, level);
+#endif
+    break;
+  }
+
+  TP_UNUSED(level);
+}
+
+//##################################################################################################
+Compressor::~Compressor()
+{
+  finish();
+
+#ifdef TP_OBJ_ZLIB
+  if(d->valid && d->compression==Compression::Gzip)
+    deflateEnd(&d->gzip);
+#endif
+
+#ifdef TP_OBJ_ZSTD
+  ZSTD_freeCCtx(d->zstd);
+#endif
+
+  delete d;
+}
+
+//##################################################################################################
+bool Compressor::isValid() const
+{
+  return d->valid;
+}
+
+//##################################################################################################
+bool Compressor::write(const char* data, size_t size)
+{
+  if(!d->valid || d->finished)
+    return false;
+
+  // zlib counts input in 32 bit units.
+  while(size>0)
+  {
+    size_t block = std::min(size, size_t(1)<<30);
+    if(!d->compress(data, block, false))
+      return false;
+    data += block;
+    size -= block;
+  }
+
+  return true;
+}
+
+//##################################################################################################
+bool Compressor::finish()
+{
+  if(!d->valid || d->finished)
+    return false;
+
+  d->finished = true;
+  return d->compress(nullptr, 0, true);
+}
+
+//##################################################################################################
+OutputBuffer::Sink Compressor::sink()
+{
+  return [this](const char* data, size_t size)
+  {
+    return write(data, size);
+  };
+}
+
+}
@@ -0,0 +1,27 @@
+#include "tp_obj/FileStamp.h"
+
+#include <filesystem>
+
+namespace tp_obj
+{
+
+//##################################################################################################
+FileStamp fileStamp(const std::string& path)
+{
+  FileStamp stamp;
+  std::error_code ec;
+
+  stamp.size = uint64_t(std::filesystem::file_size(path, ec));
+  if(ec)
+    return FileStamp();
+
+  auto modified = std::filesystem::last_write_time(path, ec);
+  if(ec)
+    return FileStamp();
+
+  stamp.exists = true;
+  stamp.modified = int64_t(modified.time_since_epoch().count());
+  return stamp;
+}
+
+}
@@ -0,0 +1,244 @@
+#include "tp_obj/MTLCache.h"
+#include "tp_obj/FileStamp.h"
+#include "tp_obj/OBJStats.h"
+
+#include "tp_utils/Progress.h"
+
+#include "tp_math_utils/materials/OpenGLMaterial.h"
+#include "tp_math_utils/materials/LegacyMaterial.h"
+
+#include <filesystem>
+#include <future>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+namespace tp_obj
+{
+
+namespace
+{
+
+using LibraryPtr = std::shared_ptr<const MTLLibrary>;
+
+//##################################################################################################
+std::string canonicalPath(const std::string& path)
+{
+  std::error_code ec;
+  auto canonical = std::filesystem::weakly_canonical(path, ec);
+  return ec?path:canonical.string();
+}
+
+//##################################################################################################
+//! A rough estimate of the memory used by a library, it does not follow strings or textures.
+size_t libraryBytes(const MTLLibrary& library)
+{
+  return sizeof(MTLLibrary) +
+      library.materials.capacity() * sizeof(tp_math_utils::Material) +
+      library.materials.size() * (sizeof(tp_math_utils::OpenGLMaterial) + sizeof(tp_math_utils::LegacyMaterial)) +
+      library.properties.capacity() * sizeof(MTLProperties);
+}
+
+//##################################################################################################
+struct CacheEntry
+{
+  FileStamp stamp;
+  std::shared_future<LibraryPtr> library;
+  size_t bytes{0};                        //!< 0 while the file is still being parsed.
+  std::list<std::string>::iterator used;  //!< Position in Cache::used.
+};
+
+//##################################################################################################
+struct Cache
+{
+  std::mutex mutex;
+  std::unordered_map<std::string, CacheEntry> entries;
+  std::list<std::string> used; //!< Paths with the most recently used first.
+  size_t capacity{64*1024*1024};
+  size_t size{0};
+
+  //################################################################################################
+  void remove(std::unordered_map<std::string, CacheEntry>::iterator i)
+  {
+    size -= i->second.bytes;
+    used.erase(i->second.used);
+    entries.erase(i);
+  }
+
+  //################################################################################################
+  //! Drop the least recently used entries until the cache fits, the newest entry is always kept.
+  void trim()
+  {
+    // Entries that are still being parsed have other threads waiting on them so they are skipped.
+    if(used.empty())
+      return;
+
+    for(auto i=std::prev(used.end()); size>capacity && i!=used.begin();)
+      if(auto entry=entries.find(*i--); entry->second.bytes>0)
+        remove(entry);
+  }
+
+  //################################################################################################
+  //! Remove the entry added for a parse if it is still there.
+  void removeParsing(const std::string& path, const FileStamp& stamp)
+  {
+    if(auto i = entries.find(path); i!=entries.end() && i->second.bytes==0 && i->second.stamp==stamp)
+      remove(i);
+  }
+};
+
+//##################################################################################################
+Cache& cache()
+{
+  static Cache cache;
+  return cache;
+}
+
+}
+
+//##################################################################################################
+std::shared_ptr<const MTLLibrary> cachedMTLLibrary(const std::string& filePath,
+                                                   tp_utils::Progress* progress,
+                                                   OBJStats* stats)
+{
+  auto& c = cache();
+
+  std::string path = canonicalPath(filePath);
+  FileStamp stamp = fileStamp(path);
+
+  bool useCache = stamp.exists;
+  std::shared_future<LibraryPtr> cached;
+  std::promise<LibraryPtr> promise;
+  if(useCache)
+  {
+    std::lock_guard<std::mutex> lock(c.mutex);
+    useCache = c.capacity>0;
+
+    if(auto i = c.entries.find(path); useCache && i!=c.entries.end())
+    {
+      if(i->second.stamp == stamp)
+      {
+        c.used.splice(c.used.begin(), c.used, i->second.used);
+        cached = i->second.library;
+      }
+      else
+        c.remove(i);
+    }
+
+    // Add the entry before parsing so that other threads wait for this parse.
+    if(useCache && !cached.valid())
+    {
+      c.used.push_front(path);
+      auto& entry = c.entries[path];
+      entry.stamp = stamp;
+      entry.library = promise.get_future().share();
+      entry.used = c.used.begin();
+    }
+  }
+
+  if(cached.valid())
+  {
+    // Another thread may still be parsing it.
+    LibraryPtr library = cached.get();
+
+    if(stats)
+      stats->mtlCacheHits++;
+
+    // The parse reported its error to the progress that it was given, which may not be this one.
+    if(!library->error.empty() && progress)
+    {
+      progress->addError("Parse MTL error: ");
+      progress->addError(library->error);
+    }
+
+    return library;
+  }
+
+  LibraryPtr library;
+  try
+  {
+    library = std::make_shared<const MTLLibrary>(parseMTLLibrary(filePath, progress, stats));
+  }
+  catch(...)
+  {
+    // Pass the failure on to threads waiting for this parse and let the next call try again.
+    if(useCache)
+    {
+      {
+        std::lock_guard<std::mutex> lock(c.mutex);
+        c.removeParsing(path, stamp);
+      }
+      promise.set_exception(std::current_exception());
+    }
+    throw;
+  }
+
+  if(!useCache)
+    return library;
+
+  promise.set_value(library);
+
+  std::lock_guard<std::mutex> lock(c.mutex);
+  if(auto i = c.entries.find(path); i!=c.entries.end() && i->second.bytes==0 && i->second.stamp==stamp)
+  {
+    i->second.bytes = libraryBytes(*library);
+    c.size += i->second.bytes;
+    c.trim();
+  }
+
+  return library;
+}
+
+//##################################################################################################
+void setMTLCacheCapacity(size_t bytes)
+{
+  auto& c = cache();
+  std::lock_guard<std::mutex> lock(c.mutex);
+  c.capacity = bytes;
+
+  if(c.capacity==0)
+  {
+    c.entries.clear();
+    c.used.clear();
+    c.size = 0;
+  }
+  else
+    c.trim();
+}
+
+//##################################################################################################
+size_t mtlCacheCapacity()
+{
+  auto& c = cache();
+  std::lock_guard<std::mutex> lock(c.mutex);
+  return c.capacity;
+}
+
+//##################################################################################################
+size_t mtlCacheSize()
+{
+  auto& c = cache();
+  std::lock_guard<std::mutex> lock(c.mutex);
+  return c.size;
+}
+
+//##################################################################################################
+void invalidateMTLCache(const std::string& filePath)
+{
+  auto& c = cache();
+  std::lock_guard<std::mutex> lock(c.mutex);
+  if(auto i = c.entries.find(canonicalPath(filePath)); i!=c.entries.end())
+    c.remove(i);
+}
+
+//##################################################################################################
+void clearMTLCache()
+{
+  auto& c = cache();
+  std::lock_guard<std::mutex> lock(c.mutex);
+  c.entries.clear();
+  c.used.clear();
+  c.size = 0;
+}
+
+}
@@ -0,0 +1,393 @@
+#include "tp_obj/OBJParser.h"
+#include "tp_obj/MTLCache.h"
+#include "tp_obj/Tokenizer.h"
+#include "tp_obj/NumberParsing.h"
+#include "tp_obj/OBJStats.h"
+#include "tp_obj/Compression.h"
+
+#include "tp_math_utils/materials/OpenGLMaterial.h"
+#include "tp_math_utils/materials/LegacyMaterial.h"
+#include "tp_math_utils/materials/ExternalMaterial.h"
+
+#include "tp_utils/FileUtils.h"
+#include "tp_utils/Progress.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <memory>
+
+namespace tp_obj
+{
+
+namespace
+{
+
+//##################################################################################################
+bool readBool(std::string_view s)
+{
+  auto ss = tpToLower(std::string(s));
+
+  if(ss == "0" || ss == "false")
+    return false;
+
+  return true;
+}
+
+//##################################################################################################
+float readFloat(std::string_view s)
+{
+  float v=0.0f;
+  if(!parseFloat(s, v) || !std::isfinite(v))
+    return 0.0f;
+  return v;
+}
+
+//##################################################################################################
+int readInt(std::string_view s)
+{
+  int n=0;
+  tpNumber(std::string(s), n);
+  return n;
+}
+
+using Parts = std::vector<std::string_view>;
+
+//##################################################################################################
+//! The material that the lines of an MTL file are currently being applied to.
+struct MaterialState
+{
+  tp_math_utils::Material* material{nullptr};
+  tp_math_utils::OpenGLMaterial* openGL{nullptr};
+  tp_math_utils::LegacyMaterial* legacy{nullptr};
+  MTLProperties* properties{nullptr};
+  std::string directory;
+
+  //################################################################################################
+  template<typename T>
+  T* object()
+  {
+    if constexpr(std::is_same_v<T, tp_math_utils::OpenGLMaterial>)
+      return openGL;
+    else if constexpr(std::is_same_v<T, tp_math_utils::LegacyMaterial>)
+      return legacy;
+    else
+      return properties;
+  }
+};
+
+//##################################################################################################
+template<typename T>
+struct MemberTraits;
+
+//##################################################################################################
+template<typename C, typename V>
+struct MemberTraits<V C::*>
+{
+  using Class = C;
+};
+
+//##################################################################################################
+template<auto member>
+auto& field(MaterialState& state)
+{
+  return state.object<typename MemberTraits<decltype(member)>::Class>()->*member;
+}
+
+//##################################################################################################
+template<auto member>
+void boolProperty(MaterialState& state, const Parts& parts)
+{
+  if(parts.size() == 2)
+    field<member>(state) = readBool(parts[1]);
+}
+
+//##################################################################################################
+template<auto member>
+void floatProperty(MaterialState& state, const Parts& parts)
+{
+  if(parts.size() == 2)
+    field<member>(state) = readFloat(parts[1]);
+}
+
+//##################################################################################################
+template<auto member>
+void intProperty(MaterialState& state, const Parts& parts)
+{
+  if(parts.size() == 2)
+    field<member>(state) = readInt(parts[1]);
+}
+
+//##################################################################################################
+template<auto member>
+void sssMethodProperty(MaterialState& state, const Parts& parts)
+{
+  if(parts.size() == 2)
+    field<member>(state) = tp_math_utils::SSSMethod(readInt(parts[1]));
+}
+
+//##################################################################################################
+template<auto member>
+void vec3Property(MaterialState& state, const Parts& parts)
+{
+  if(parts.size() == 4)
+  {
+    auto& value = field<member>(state);
+    value.x = readFloat(parts[1]);
+    value.y = readFloat(parts[2]);
+    value.z = readFloat(parts[3]);
+  }
+}
+
+//##################################################################################################
+template<auto member>
+void mapProperty(MaterialState& state, const Parts& parts)
+{
+  field<member>(state) = splitTextureOptions(joinName(parts)).file;
+}
+
+//##################################################################################################
+// Ambient Texture Map, only used if there is no diffuse map.
+void ambientMapProperty(MaterialState& state, const Parts& parts)
+{
+  if(!state.openGL->albedoTexture.isValid())
+    state.openGL->albedoTexture = joinName(parts);
+}
+
+//##################################################################################################
+// Blender material
+void blendProperty(MaterialState& state, const Parts& parts)
+{
+  auto externalMaterial = state.material->findOrAddExternal("blend");
+  externalMaterial->subPath = tp_utils::pathAppend(state.directory, joinName(parts));
+
+  // Adding a material type can move the others so look them up again on the next line.
+  state.openGL = nullptr;
+  state.legacy = nullptr;
+}
+
+//##################################################################################################
+struct Keyword
+{
+  std::string_view name;
+  void (*setter)(MaterialState&, const Parts&);
+};
+
+using GL = tp_math_utils::OpenGLMaterial;
+using LM = tp_math_utils::LegacyMaterial;
+using MP = MTLProperties;
+
+//##################################################################################################
+constexpr std::array unsortedKeywords
+{
+  //-- Wavefront material properties ---------------------------------------------------------------
+  Keyword{"Ka"                        , &vec3Property     <&MP::ambient                      >}, // Ambient Color
+  Keyword{"Kd"                        , &vec3Property     <&GL::albedo                       >}, // Diffuse Color
+  Keyword{"Ks"                        , &vec3Property     <&MP::specular                     >}, // Specular Color
+  Keyword{"Ns"                        , &floatProperty    <&MP::specularExponent             >}, // Specular Exponent
+  Keyword{"Ni"                        , &floatProperty    <&MP::opticalDensity               >}, // Optical Density
+  Keyword{"d"                         , &floatProperty    <&GL::alpha                        >}, // Dissolve
+  Keyword{"illum"                     , &intProperty      <&MP::illuminationModel            >}, // Illumination
+  Keyword{"map_Ka"                    , &ambientMapProperty                                   }, // Ambient Texture Map
+  Keyword{"map_Kd"                    , &mapProperty      <&GL::albedoTexture                >}, // Diffuse Texture Map
+  Keyword{"map_Ks"                    , &mapProperty      <&MP::specularTexture              >}, // Specular Texture Map
+  Keyword{"map_Ns"                    , &mapProperty      <&MP::specularExponentTexture      >}, // Specular Hightlight Map
+  Keyword{"map_d"                     , &mapProperty      <&GL::alphaTexture                 >}, // Alpha Texture Map
+  Keyword{"map_Bump"                  , &mapProperty      <&GL::normalsTexture               >}, // Bump Map
+  Keyword{"map_bump"                  , &mapProperty      <&GL::normalsTexture               >}, // Bump Map
+  Keyword{"bump"                      , &mapProperty      <&GL::normalsTexture               >}, // Bump Map
+  Keyword{"norm"                      , &mapProperty      <&GL::normalsTexture               >}, // Bump Map
+  Keyword{"map_ao"                    , &mapProperty      <&MP::ambientOcclusionTexture      >}, // Ambient Occlusion Map
+  Keyword{"bml"                       , &blendProperty                                        }, // Blender Material
+
+  //-- Extended material properties ----------------------------------------------------------------
+  Keyword{"Roughness"                 , &floatProperty    <&GL::roughness                    >},
+  Keyword{"Metalness"                 , &floatProperty    <&GL::metalness                    >},
+  Keyword{"Specular"                  , &floatProperty    <&LM::specular                     >},
+  Keyword{"Emission"                  , &vec3Property     <&LM::emission                     >},
+  Keyword{"EmissionStrength"          , &floatProperty    <&LM::emissionScale                >},
+  Keyword{"Subsurface"                , &vec3Property     <&LM::sss                          >},
+  Keyword{"SubsurfaceScale"           , &floatProperty    <&LM::sssScale                     >},
+  Keyword{"SubsurfaceRadius"          , &vec3Property     <&LM::sssRadius                    >},
+  Keyword{"SubsurfaceMethod"          , &sssMethodProperty<&LM::sssMethod                    >},
+  Keyword{"NormalStrength"            , &floatProperty    <&LM::normalStrength               >},
+  Keyword{"Transmission"              , &floatProperty    <&GL::transmission                 >},
+  Keyword{"TransmissionRoughness"     , &floatProperty    <&GL::transmissionRoughness        >},
+  Keyword{"Sheen"                     , &floatProperty    <&LM::sheen                        >},
+  Keyword{"SheenTint"                 , &floatProperty    <&LM::sheenTint                    >},
+  Keyword{"ClearCoat"                 , &floatProperty    <&LM::clearCoat                    >},
+  Keyword{"ClearCoatRoughness"        , &floatProperty    <&LM::clearCoatRoughness           >},
+  Keyword{"IOR"                       , &floatProperty    <&LM::ior                          >},
+  Keyword{"albedoBrightness"          , &floatProperty    <&GL::albedoBrightness             >},
+  Keyword{"albedoContrast"            , &floatProperty    <&GL::albedoContrast               >},
+  Keyword{"albedoGamma"               , &floatProperty    <&GL::albedoGamma                  >},
+  Keyword{"albedoHue"                 , &floatProperty    <&GL::albedoHue                    >},
+  Keyword{"albedoSaturation"          , &floatProperty    <&GL::albedoSaturation             >},
+  Keyword{"albedoValue"               , &floatProperty    <&GL::albedoValue                  >},
+  Keyword{"albedoFactor"              , &floatProperty    <&GL::albedoFactor                 >},
+  Keyword{"rayVisibilityCamera"       , &boolProperty     <&LM::rayVisibilityCamera          >},
+  Keyword{"rayVisibilityDiffuse"      , &boolProperty     <&LM::rayVisibilityDiffuse         >},
+  Keyword{"rayVisibilityGlossy"       , &boolProperty     <&LM::rayVisibilityGlossy          >},
+  Keyword{"rayVisibilityTransmission" , &boolProperty     <&LM::rayVisibilityTransmission    >},
+  Keyword{"rayVisibilityScatter"      , &boolProperty     <&LM::rayVisibilityScatter         >},
+  Keyword{"rayVisibilityShadow"       , &boolProperty     <&LM::rayVisibilityShadow          >},
+  Keyword{"rayVisibilityShadowCatcher", &boolProperty     <&GL::rayVisibilityShadowCatcher   >},
+  Keyword{"map_ClearCoat"             , &mapProperty      <&LM::clearCoatTexture             >},
+  Keyword{"map_ClearCoatRoughness"    , &mapProperty      <&LM::clearCoatRoughnessTexture    >},
+  Keyword{"map_Emission"              , &mapProperty      <&LM::emissionTexture              >},
+  Keyword{"map_Metalness"             , &mapProperty      <&GL::metalnessTexture             >},
+  Keyword{"map_Roughness"             , &mapProperty      <&GL::roughnessTexture             >},
+  Keyword{"map_Sheen"                 , &mapProperty      <&LM::sheenTexture                 >},
+  Keyword{"map_SheenTint"             , &mapProperty      <&LM::sheenTintTexture             >},
+  Keyword{"map_Specular"              , &mapProperty      <&LM::specularTexture              >},
+  Keyword{"map_Subsurface"            , &mapProperty      <&LM::sssTexture                   >},
+  Keyword{"map_SubsurfaceScale"       , &mapProperty      <&LM::sssScaleTexture              >},
+  Keyword{"map_Transmission"          , &mapProperty      <&GL::transmissionTexture          >},
+  Keyword{"map_TransmissionRoughness" , &mapProperty      <&GL::transmissionRoughnessTexture >}
+};
+
+//##################################################################################################
+template<size_t N>
+constexpr std::array<Keyword, N> sortKeywords(std::array<Keyword, N> keywords)
+{
+  for(size_t i=1; i<N; i++)
+  {
+    for(size_t j=i; j>0 && keywords[j].name<keywords[j-1].name; j--)
+    {
+      Keyword tmp = keywords[j];
+      keywords[j] = keywords[j-1];
+      keywords[j-1] = tmp;
+    }
+  }
+  return keywords;
+}
+
+//##################################################################################################
+template<size_t N>
+constexpr bool keywordsUnique(const std::array<Keyword, N>& keywords)
+{
+  for(size_t i=1; i<N; i++)
+    if(!(keywords[i-1].name<keywords[i].name))
+      return false;
+  return true;
+}
+
+//##################################################################################################
+//! The keywords sorted by name for binary search.
+constexpr auto keywords = sortKeywords(unsortedKeywords);
+static_assert(keywordsUnique(keywords), "MTL keywords must be unique.");
+
+//##################################################################################################
+const Keyword* findKeyword(std::string_view name)
+{
+  auto i = std::lower_bound(keywords.begin(), keywords.end(), name, [](const Keyword& keyword, std::string_view name)
+  {
+    return keyword.name < name;
+  });
+
+  return (i!=keywords.end() && i->name==name)?i:nullptr;
+}
+
+}
+
+//##################################################################################################
+MTLLibrary parseMTLLibrary(const std::string& filePath,
+                           tp_utils::Progress* progress,
+                           OBJStats* stats)
+{
+  OBJStatsTimer timer(stats?&stats->materialSeconds:nullptr);
+
+  std::unique_ptr<MappedFile> mappedFile;
+  {
+    OBJStatsTimer ioTimer(stats?&stats->ioSeconds:nullptr);
+    mappedFile = std::make_unique<MappedFile>(filePath);
+  }
+  const MappedFile& file = *mappedFile;
+
+  if(stats)
+    stats->bytes += file.text().size();
+
+  MTLLibrary library;
+
+  MaterialState state;
+  state.directory = tp_utils::directoryName(filePath);
+
+  std::string error;
+  bool ok = forEachTextBlock(file.text(), [&](std::string_view text, float)
+  {
+    LineTokenizer tokenizer(text);
+    while(tokenizer.next())
+    {
+      const auto& parts = tokenizer.parts();
+      std::string_view c = parts.front();
+
+      if(stats)
+        stats->lines++;
+
+      if(c == "newmtl")
+      {
+        if(stats)
+          stats->materials++;
+
+        auto& m = library.materials.emplace_back();
+        m.name = joinName(parts);
+
+        if(!m.name.isValid())
+          m.name = "none";
+
+        state.material = &m;
+        state.openGL = nullptr;
+        state.legacy = nullptr;
+        state.properties = &library.properties.emplace_back();
+        continue;
+      }
+
+      if(!state.material)
+        continue;
+
+      // Only look up the material types once per material.
+      if(!state.openGL)
+      {
+        state.openGL = state.material->findOrAddOpenGL();
+        state.legacy = state.material->findOrAddLegacy();
+      }
+
+      if(const Keyword* keyword = findKeyword(c); keyword)
+        keyword->setter(state, parts);
+    }
+    return true;
+  }, error);
+
+  if(!ok)
+  {
+    library.error = filePath + ": " + error;
+    if(progress)
+    {
+      progress->addError("Parse MTL error: ");
+      progress->addError(library.error);
+    }
+  }
+
+  return library;
+}
+
+//##################################################################################################
+bool parseMTL(const std::string& filePath,
+              std::vector<tp_math_utils::Material>& outputMaterials,
+              tp_utils::Progress* progress,
+              OBJStats* stats,
+              std::vector<MTLProperties>* outputProperties)
+{
+  auto library = cachedMTLLibrary(filePath, progress, stats);
+
+  OBJStatsTimer timer(stats?&stats->materialSeconds:nullptr);
+
+  outputMaterials.insert(outputMaterials.end(), library->materials.begin(), library->materials.end());
+
+  if(outputProperties)
+    outputProperties->insert(outputProperties->end(), library->properties.begin(), library->properties.end());
+
+  return true;
+}
+
+}
@@ -0,0 +1,48 @@
+#include "tp_obj/MaterialIndex.h"
+
+namespace tp_obj
+{
+
+//##################################################################################################
+void MaterialIndex::addLibraries(const std::vector<std::string>& materialLibraries,
+                                 tp_utils::Progress* progress,
+                                 OBJStats* stats)
+{
+  for(const auto& materialLibrary : materialLibraries)
+  {
+    const auto& library = libraries.emplace_back(cachedMTLLibrary(materialLibrary, progress, stats));
+
+    byName.reserve(byName.size() + library->materials.size());
+    for(size_t i=0; i<library->materials.size(); i++)
+    {
+      Entry entry;
+      entry.material = &library->materials.at(i);
+      if(i<library->properties.size())
+        entry.properties = &library->properties.at(i);
+      byName.emplace(entry.material->name, entry);
+    }
+  }
+}
+
+//##################################################################################################
+void MaterialIndex::merge(const MaterialIndex& other)
+{
+  libraries.insert(libraries.end(), other.libraries.begin(), other.libraries.end());
+  byName.insert(other.byName.begin(), other.byName.end());
+}
+
+//##################################################################################################
+const tp_math_utils::Material* MaterialIndex::find(const tp_utils::StringID& name) const
+{
+  auto i = byName.find(name);
+  return (i!=byName.end())?i->second.material:nullptr;
+}
+
+//##################################################################################################
+const MTLProperties* MaterialIndex::findProperties(const tp_utils::StringID& name) const
+{
+  auto i = byName.find(name);
+  return (i!=byName.end())?i->second.properties:nullptr;
+}
+
+}
@@ -0,0 +1,115 @@
+#include "tp_obj/MaterialPrefetch.h"
+#include "tp_obj/MTLCache.h"
+#include "tp_obj/OBJReader.h"
+#include "tp_obj/OBJStats.h"
+#include "tp_obj/Tokenizer.h"
+#include "tp_obj/Compression.h"
+
+#include "tp_utils/FileUtils.h"
+
+#include <future>
+
+namespace tp_obj
+{
+
+namespace
+{
+
+//##################################################################################################
+// Exporters write mtllib lines in the header so only the start of the file is scanned.
+constexpr size_t prescanBytes = 64*1024;
+
+//##################################################################################################
+struct LibraryVisitor : public OBJVisitor
+{
+  //################################################################################################
+  void materialLibrary(const std::string& fileName) override
+  {
+    materialLibraries.push_back(fileName);
+  }
+
+  std::vector<std::string> materialLibraries;
+};
+
+//##################################################################################################
+std::vector<std::string> prescanMaterialLibraries(const std::string& filePath)
+{
+  LibraryVisitor visitor;
+
+  MappedFile file(filePath);
+  std::string error;
+  forEachTextBlock(file.text(), [&](std::string_view text, float)
+  {
+    // Only scan whole lines from the start of the text.
+    if(text.size()>prescanBytes)
+      text = text.substr(0, text.rfind('\n', prescanBytes)+1);
+
+    readOBJText(text, false, visitor, nullptr, error, OBJMaterialLibraries);
+    return false;
+  }, error, prescanBytes);
+
+  std::vector<std::string> materialLibraries;
+  for(const auto& library : visitor.materialLibraries)
+    materialLibraries.push_back(tp_utils::pathAppend(tp_utils::directoryName(filePath), library));
+  return materialLibraries;
+}
+
+}
+
+//##################################################################################################
+struct MaterialPrefetch::Private
+{
+  std::future<OBJStats> future;
+};
+
+//##################################################################################################
+MaterialPrefetch::MaterialPrefetch(const std::string& filePath, bool enabled):
+  d(new Private())
+{
+  if(!enabled || mtlCacheCapacity()==0)
+    return;
+
+  d->future = std::async(std::launch::async, [filePath]
+  {
+    // Failures are dropped here, assignMaterials parses the library again and reports them. If
+    // they escaped they would be rethrown by the destructor.
+    OBJStats stats;
+    try
+    {
+      for(const auto& materialLibrary : prescanMaterialLibraries(filePath))
+      {
+        try
+        {
+          cachedMTLLibrary(materialLibrary, nullptr, &stats);
+        }
+        catch(...)
+        {
+        }
+      }
+    }
+    catch(...)
+    {
+    }
+    return stats;
+  });
+}
+
+//##################################################################################################
+MaterialPrefetch::~MaterialPrefetch()
+{
+  join(nullptr);
+  delete d;
+}
+
+//##################################################################################################
+void MaterialPrefetch::join(OBJStats* stats)
+{
+  if(!d->future.valid())
+    return;
+
+  OBJStats prefetchStats = d->future.get();
+  if(stats)
+    stats->add(prefetchStats);
+}
+
+}
@@ -0,0 +1,208 @@
+#include "tp_obj/NumberParsing.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <cmath>
+#include <limits>
+
+#if !defined(__cpp_lib_to_chars)
+#  include <sstream>
+#endif
+
+namespace tp_obj
+{
+
+namespace
+{
+
+//##################################################################################################
+// Powers of ten that are exactly representable as doubles.
+constexpr double powersOfTen[] =
+{
+  1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+constexpr int maxFastDigits = 19;
+constexpr int maxFastExponent = 22;
+constexpr uint64_t maxFastMantissa = uint64_t(1)<<53;
+
+//##################################################################################################
+inline bool isDigit(char c)
+{
+  return unsigned(static_cast<unsigned char>(c)) - unsigned('0') < 10u;
+}
+
+#if (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) || defined(_WIN32)
+#define TP_OBJ_SWAR_DIGITS
+
+//##################################################################################################
+// Check 8 bytes loaded little endian for ASCII digits.
+inline bool isEightDigits(uint64_t v)
+{
+  return (((v & 0xF0F0F0F0F0F0F0F0) | (((v + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4)) ==
+          0x3333333333333333);
+}
+
+//##################################################################################################
+// Convert 8 ASCII digits loaded little endian into an integer using 3 multiplies.
+inline uint32_t parseEightDigits(uint64_t v)
+{
+  constexpr uint64_t mask = 0x000000FF000000FF;
+  constexpr uint64_t mul1 = 0x000F424000000064; // 100 + (1000000ULL << 32)
+  constexpr uint64_t mul2 = 0x0000271000000001; // 1 + (10000ULL << 32)
+  v -= 0x3030303030303030;
+  v = (v * 10) + (v >> 8);
+  v = (((v & mask) * mul1) + (((v >> 16) & mask) * mul2)) >> 32;
+  return uint32_t(v);
+}
+#endif
+
+//##################################################################################################
+// Exact conversion of decimals with up to 19 digits and no exponent. The mantissa and power of ten
+// are both exact doubles so the division is correctly rounded, the only case where rounding that
+// to a float can differ from rounding the decimal directly is when it lands exactly on a midpoint
+// between two floats, that case is left to the slow path. Returns false to use the slow path.
+bool parseFixed(const char* c, const char* end, bool negative, float& value)
+{
+  uint64_t mantissa=0;
+  int digits=0;
+  int fractionDigits=0;
+
+  for(; c<end && isDigit(*c); c++)
+  {
+    if(++digits>maxFastDigits)
+      return false;
+    mantissa = mantissa*10 + uint64_t(*c-'0');
+  }
+
+  if(c<end && *c=='.')
+  {
+    c++;
+
+#ifdef TP_OBJ_SWAR_DIGITS
+    while(end-c>=8 && digits+8<=maxFastDigits)
+    {
+      uint64_t chunk;
+      std::memcpy(&chunk, c, 8);
+      if(!isEightDigits(chunk))
+        break;
+
+      mantissa = mantissa*100000000 + parseEightDigits(chunk);
+      digits += 8;
+      fractionDigits += 8;
+      c += 8;
+    }
+#endif
+
+    for(; c<end && isDigit(*c); c++)
+    {
+      if(++digits>maxFastDigits)
+        return false;
+      mantissa = mantissa*10 + uint64_t(*c-'0');
+      fractionDigits++;
+    }
+  }
+
+  if(digits==0 || fractionDigits>maxFastExponent || mantissa>maxFastMantissa)
+    return false;
+
+  if(c<end && (*c=='e' || *c=='E'))
+    return false;
+
+  double d = double(mantissa) / powersOfTen[fractionDigits];
+
+  uint64_t bits;
+  std::memcpy(&bits, &d, 8);
+  if((bits & 0x1FFFFFFF) == 0x10000000)
+    return false;
+
+  value = negative?-float(d):float(d);
+  return true;
+}
+
+//##################################################################################################
+bool parseGeneral(const char* c, const char* end, bool negative, float& value)
+{
+#if defined(__cpp_lib_to_chars)
+  auto result = std::from_chars(c, end, value);
+
+  if(result.ec == std::errc::invalid_argument)
+    return false;
+
+  if(result.ec == std::errc::result_out_of_range)
+  {
+    // from_chars does not set the value on over or underflow so work out which one it was from the
+    // decimal exponent of the leading significant digit, it is below zero for values under one.
+    const char* e=c;
+    long magnitude=0;
+    bool significant=false;
+    for(; e<result.ptr && *e>='0' && *e<='9'; e++)
+      if(significant || *e!='0')
+      {
+        significant = true;
+        magnitude++;
+      }
+
+    if(e<result.ptr && *e=='.')
+      for(e++; !significant && e<result.ptr && *e>='0' && *e<='9'; e++)
+      {
+        if(*e!='0')
+          significant = true;
+        else
+          magnitude--;
+      }
+
+    for(; e<result.ptr && *e!='e' && *e!='E'; e++){}
+
+    if(e+1<result.ptr)
+    {
+      bool negativeExponent = (e[1]=='-');
+      long exponent=0;
+      for(e+=(e[1]=='-' || e[1]=='+')?2:1; e<result.ptr && *e>='0' && *e<='9'; e++)
+        exponent = std::min(exponent*10 + long(*e-'0'), 1000000L);
+      magnitude += negativeExponent?-exponent:exponent;
+    }
+
+    value = (magnitude<=0)?0.0f:std::numeric_limits<float>::infinity();
+  }
+#else
+  std::istringstream istr(std::string(c, size_t(end-c)));
+  istr.imbue(std::locale::classic());
+  istr >> value;
+  if(istr.fail())
+    return false;
+#endif
+
+  if(negative)
+    value = -value;
+
+  return true;
+}
+
+}
+
+//##################################################################################################
+bool parseFloat(std::string_view text, float& value)
+{
+  const char* c = text.data();
+  const char* end = c + text.size();
+
+  bool negative=false;
+  if(c<end && (*c=='-' || *c=='+'))
+  {
+    negative = (*c=='-');
+    c++;
+  }
+
+  if(c==end || *c=='-' || *c=='+')
+    return false;
+
+  if(parseFixed(c, end, negative, value))
+    return true;
+
+  return parseGeneral(c, end, negative, value);
+}
+
+}
@@ -0,0 +1,285 @@
+#include "tp_obj/OBJCache.h"
+#include "tp_obj/Tokenizer.h"
+#include "tp_obj/FileStamp.h"
+#include "tp_obj/BinaryFile.h"
+
+#include "tp_utils/FileUtils.h"
+
+namespace tp_obj
+{
+
+namespace
+{
+
+//##################################################################################################
+// Increment this when the layout of the cache file changes.
+constexpr char cacheMagic[8] = {'T', 'P', 'O', 'B', 'J', 'C', '0', '3'};
+constexpr uint32_t cacheByteOrder = 0x01020304;
+
+//##################################################################################################
+void writeHeader(BinaryWriter& writer,
+                 const std::string& filePath,
+                 const FileStamp& stamp,
+                 const OBJCacheParameters& parameters)
+{
+  for(char c : cacheMagic)
+    writer.write(c);
+  writer.write(cacheByteOrder);
+  writer.write(uint32_t(sizeof(size_t)));
+
+  writer.writeString(absolutePath(filePath));
+  writer.writeStamp(stamp);
+  writer.write(int32_t(parameters.triangleFan));
+  writer.write(int32_t(parameters.triangleStrip));
+  writer.write(int32_t(parameters.triangles));
+  writer.write(uint8_t(parameters.reverse));
+  writer.write(uint8_t(parameters.optimizeVertexOrder));
+  writer.write(uint8_t(parameters.weld));
+  writer.write(parameters.weldPosition);
+  writer.write(parameters.weldTexCoord);
+  writer.write(parameters.weldNormal);
+}
+
+//##################################################################################################
+bool checkHeader(BinaryReader& reader,
+                 const std::string& filePath,
+                 const OBJCacheParameters& parameters)
+{
+  for(char c : cacheMagic)
+    if(char r=0; !reader.read(r) || r!=c)
+      return false;
+
+  uint32_t byteOrder=0;
+  uint32_t sizeOfSize=0;
+  if(!reader.read(byteOrder) || byteOrder!=cacheByteOrder ||
+     !reader.read(sizeOfSize) || sizeOfSize!=sizeof(size_t))
+    return false;
+
+  std::string path;
+  FileStamp stamp;
+  int32_t triangleFan=0;
+  int32_t triangleStrip=0;
+  int32_t triangles=0;
+  uint8_t reverse=0;
+  uint8_t optimizeVertexOrder=0;
+  uint8_t weld=0;
+  float weldPosition=0.0f;
+  float weldTexCoord=0.0f;
+  float weldNormal=0.0f;
+
+  if(!reader.readString(path) ||
+     !reader.readStamp(stamp) ||
+     !reader.read(triangleFan) ||
+     !reader.read(triangleStrip) ||
+     !reader.read(triangles) ||
+     !reader.read(reverse) ||
+     !reader.read(optimizeVertexOrder) ||
+     !reader.read(weld) ||
+     !reader.read(weldPosition) ||
+     !reader.read(weldTexCoord) ||
+     !reader.read(weldNormal))
+    return false;
+
+  return path == absolutePath(filePath) &&
+      stamp.exists &&
+      stamp == fileStamp(filePath) &&
+      triangleFan == parameters.triangleFan &&
+      triangleStrip == parameters.triangleStrip &&
+      triangles == parameters.triangles &&
+      bool(reverse) == parameters.reverse &&
+      bool(optimizeVertexOrder) == parameters.optimizeVertexOrder &&
+      bool(weld) == parameters.weld &&
+      weldPosition == parameters.weldPosition &&
+      weldTexCoord == parameters.weldTexCoord &&
+      weldNormal == parameters.weldNormal;
+}
+
+}
+
+//##################################################################################################
+std::string objCachePath(const std::string& filePath,
+                         const std::string& cacheDirectory)
+{
+  if(cacheDirectory.empty())
+    return filePath + ".tpobjcache";
+
+  // Files with the same name in different directories need their own cache.
+  std::string name = tp_utils::fileName(filePath);
+  name += '.';
+  name += std::to_string(std::hash<std::string>()(absolutePath(filePath)));
+  name += ".tpobjcache";
+  return tp_utils::pathAppend(cacheDirectory, name);
+}
+
+//##################################################################################################
+bool loadOBJCache(const std::string& cachePath,
+                  const std::string& filePath,
+                  const OBJCacheParameters& parameters,
+                  std::string& exporterVersion,
+                  std::vector<tp_math_utils::Geometry3D>& outputGeometry,
+                  std::vector<std::string>& materialLibraries)
+{
+  MappedFile file(cachePath);
+  if(!file.isValid())
+    return false;
+
+  BinaryReader reader(file.text());
+  if(!checkHeader(reader, filePath, parameters))
+    return false;
+
+  std::string version;
+  if(!reader.readString(version))
+    return false;
+
+  std::vector<std::string> libraries;
+  {
+    uint64_t count=0;
+    if(!reader.read(count))
+      return false;
+
+    for(uint64_t i=0; i<count; i++)
+    {
+      auto& library = libraries.emplace_back();
+      FileStamp stamp;
+      if(!reader.readString(library) || !reader.readStamp(stamp))
+        return false;
+
+      if(!(stamp == fileStamp(library)))
+        return false;
+    }
+  }
+
+  std::vector<tp_math_utils::Geometry3D> geometry;
+  {
+    uint64_t count=0;
+    if(!reader.read(count))
+      return false;
+
+    std::vector<float> verts;
+    for(uint64_t i=0; i<count; i++)
+    {
+      auto& o = geometry.emplace_back();
+
+      int32_t triangleFan=0;
+      int32_t triangleStrip=0;
+      int32_t triangles=0;
+      std::string materialName;
+      uint64_t commentCount=0;
+
+      if(!reader.read(triangleFan) ||
+         !reader.read(triangleStrip) ||
+         !reader.read(triangles) ||
+         !reader.readString(materialName) ||
+         !reader.read(commentCount))
+        return false;
+
+      o.triangleFan = triangleFan;
+      o.triangleStrip = triangleStrip;
+      o.triangles = triangles;
+      o.material.name = materialName;
+
+      for(uint64_t c=0; c<commentCount; c++)
+        if(!reader.readString(o.comments.emplace_back()))
+          return false;
+
+      if(!reader.readArray(verts) || verts.size()%8!=0)
+        return false;
+
+      o.verts.resize(verts.size()/8);
+      const float* f = verts.data();
+      for(auto& v : o.verts)
+      {
+        v.vert    = {f[0], f[1], f[2]};
+        v.texture = {f[3], f[4]};
+        v.normal  = {f[5], f[6], f[7]};
+        f += 8;
+      }
+
+      uint64_t indexCount=0;
+      if(!reader.read(indexCount))
+        return false;
+
+      for(uint64_t n=0; n<indexCount; n++)
+      {
+        auto& indexes = o.indexes.emplace_back();
+        int32_t type=0;
+        if(!reader.read(type) || !reader.readArray(indexes.indexes))
+          return false;
+        indexes.type = type;
+      }
+    }
+  }
+
+  if(!version.empty())
+    exporterVersion = version;
+
+  materialLibraries.insert(materialLibraries.end(), libraries.begin(), libraries.end());
+
+  outputGeometry.reserve(outputGeometry.size() + geometry.size());
+  for(auto& o : geometry)
+    outputGeometry.push_back(std::move(o));
+
+  return true;
+}
+
+//##################################################################################################
+bool saveOBJCache(const std::string& cachePath,
+                  const std::string& filePath,
+                  const FileStamp& stamp,
+                  const OBJCacheParameters& parameters,
+                  const std::string& exporterVersion,
+                  const std::vector<tp_math_utils::Geometry3D>& geometry,
+                  const std::vector<std::string>& materialLibraries)
+{
+  return writeBinaryFile(cachePath, [&](BinaryWriter& writer)
+  {
+    writeHeader(writer, filePath, stamp, parameters);
+
+    writer.writeString(exporterVersion);
+
+    writer.write(uint64_t(materialLibraries.size()));
+    for(const auto& library : materialLibraries)
+    {
+      writer.writeString(library);
+      writer.writeStamp(fileStamp(library));
+    }
+
+    writer.write(uint64_t(geometry.size()));
+    std::vector<float> verts;
+    for(const auto& o : geometry)
+    {
+      writer.write(int32_t(o.triangleFan));
+      writer.write(int32_t(o.triangleStrip));
+      writer.write(int32_t(o.triangles));
+      writer.writeString(o.material.name.toString());
+
+      writer.write(uint64_t(o.comments.size()));
+      for(const auto& comment : o.comments)
+        writer.writeString(comment);
+
+      verts.clear();
+      verts.reserve(o.verts.size()*8);
+      for(const auto& v : o.verts)
+      {
+        verts.push_back(v.vert.x);
+        verts.push_back(v.vert.y);
+        verts.push_back(v.vert.z);
+        verts.push_back(v.texture.x);
+        verts.push_back(v.texture.y);
+        verts.push_back(v.normal.x);
+        verts.push_back(v.normal.y);
+        verts.push_back(v.normal.z);
+      }
+      writer.writeArray(verts);
+
+      writer.write(uint64_t(o.indexes.size()));
+      for(const auto& indexes : o.indexes)
+      {
+        writer.write(int32_t(indexes.type));
+        writer.writeArray(indexes.indexes);
+      }
+    }
+  });
+}
+
+}
@@ -0,0 +1,391 @@
+#include "tp_obj/OBJIndex.h"
+#include "tp_obj/OBJReader.h"
+#include "tp_obj/OBJCache.h"
+#include "tp_obj/Tokenizer.h"
+#include "tp_obj/FileStamp.h"
+#include "tp_obj/BinaryFile.h"
+
+#include <algorithm>
+
+namespace tp_obj
+{
+
+namespace
+{
+
+//##################################################################################################
+// Increment this when the layout of the index file changes.
+constexpr char indexMagic[8] = {'T', 'P', 'O', 'B', 'J', 'I', '0', '1'};
+constexpr uint32_t indexByteOrder = 0x01020304;
+
+//##################################################################################################
+//! Collects the lowest and highest index of each attribute used by the faces it is given.
+class ReferenceVisitor : public OBJVisitor
+{
+public:
+  //################################################################################################
+  void face(const std::vector<OBJCorner>& corners) override
+  {
+    for(const auto& corner : corners)
+    {
+      if(!corner.valid)
+        continue;
+
+      m_positions.add(corner.vvi);
+      m_texCoords.add(corner.vti);
+      m_normals.add(corner.vni);
+    }
+  }
+
+  //################################################################################################
+  //! Write the ranges to the section, limited to the attributes that exist in the file.
+  void finish(OBJSection& section, const OBJIndex& index) const
+  {
+    section.positions = m_positions.range(index.positions);
+    section.texCoords = m_texCoords.range(index.texCoords);
+    section.normals   = m_normals  .range(index.normals  );
+  }
+
+private:
+  //################################################################################################
+  struct MinMax
+  {
+    size_t min{SIZE_MAX};
+    size_t max{0};
+
+    //##############################################################################################
+    void add(size_t i)
+    {
+      min = std::min(min, i);
+      max = std::max(max, i);
+    }
+
+    //##############################################################################################
+    OBJIndexRange range(size_t count) const
+    {
+      OBJIndexRange r;
+      if(min<count)
+      {
+        r.first = min;
+        r.count = std::min(max, count-1) + 1 - min;
+      }
+      return r;
+    }
+  };
+
+  MinMax m_positions;
+  MinMax m_texCoords;
+  MinMax m_normals;
+};
+
+//##################################################################################################
+void writeRange(BinaryWriter& writer, const OBJIndexRange& range)
+{
+  writer.write(uint64_t(range.first));
+  writer.write(uint64_t(range.count));
+}
+
+//##################################################################################################
+bool readRange(BinaryReader& reader, OBJIndexRange& range)
+{
+  uint64_t first=0;
+  uint64_t count=0;
+  if(!reader.read(first) || !reader.read(count))
+    return false;
+
+  range.first = size_t(first);
+  range.count = size_t(count);
+  return true;
+}
+
+//##################################################################################################
+void writeHeader(BinaryWriter& writer, const std::string& filePath, const FileStamp& stamp)
+{
+  for(char c : indexMagic)
+    writer.write(c);
+  writer.write(indexByteOrder);
+
+  writer.writeString(absolutePath(filePath));
+  writer.writeStamp(stamp);
+}
+
+//##################################################################################################
+bool checkHeader(BinaryReader& reader, const std::string& filePath)
+{
+  for(char c : indexMagic)
+    if(char r=0; !reader.read(r) || r!=c)
+      return false;
+
+  uint32_t byteOrder=0;
+  if(!reader.read(byteOrder) || byteOrder!=indexByteOrder)
+    return false;
+
+  std::string path;
+  FileStamp stamp;
+  if(!reader.readString(path) || !reader.readStamp(stamp))
+    return false;
+
+  return path == absolutePath(filePath) && stamp.exists && stamp == fileStamp(filePath);
+}
+
+}
+
+//##################################################################################################
+void buildOBJIndex(std::string_view text, OBJIndex& index, size_t maxBlockLines)
+{
+  index = OBJIndex();
+
+  std::string object;
+  std::string group;
+  std::string material;
+
+  // Faces before the first o, g, or usemtl line go in a section with empty names.
+  index.sections.emplace_back();
+
+  bool inBlock=false;
+  size_t blockLines=0;
+
+  LineTokenizer tokenizer(text, &index.exporterVersion);
+  while(tokenizer.next())
+  {
+    const auto& parts = tokenizer.parts();
+    const std::string_view& c = parts.front();
+    size_t lineStart = size_t(c.data() - text.data());
+    size_t lineEnd = tokenizer.position();
+
+    bool attribute = (c=="v" || c=="vt" || c=="vn");
+    if(!attribute)
+    {
+      inBlock = false;
+
+      if(c=="f")
+        index.sections.back().faces++;
+
+      else if(c=="o" || c=="g" || c=="usemtl")
+      {
+        if(c=="o")
+          object = joinName(parts);
+        else if(c=="g")
+          group = joinName(parts);
+        else
+          material = joinName(parts);
+
+        auto& previous = index.sections.back();
+        previous.size = lineStart - previous.offset;
+
+        auto& section = index.sections.emplace_back();
+        section.object = object;
+        section.group = group;
+        section.material = material;
+        section.offset = lineStart;
+      }
+
+      else if(c=="mtllib")
+        index.materialLibraries.push_back(joinName(parts));
+
+      continue;
+    }
+
+    if(!inBlock || blockLines>=maxBlockLines)
+    {
+      inBlock = true;
+      blockLines = 0;
+      auto& block = index.blocks.emplace_back();
+      block.offset = lineStart;
+      block.positions.first = index.positions;
+      block.texCoords.first = index.texCoords;
+      block.normals.first = index.normals;
+    }
+
+    auto& block = index.blocks.back();
+    block.size = lineEnd - block.offset;
+    blockLines++;
+
+    if(c=="v")
+    {
+      block.positions.count++;
+      index.positions++;
+    }
+    else if(c=="vt")
+    {
+      block.texCoords.count++;
+      index.texCoords++;
+    }
+    else
+    {
+      block.normals.count++;
+      index.normals++;
+    }
+  }
+
+  index.sections.back().size = text.size() - index.sections.back().offset;
+
+  // Sections without faces never produce geometry.
+  index.sections.erase(std::remove_if(index.sections.begin(), index.sections.end(), [](const auto& section)
+  {
+    return section.faces==0;
+  }), index.sections.end());
+
+  for(auto& section : index.sections)
+  {
+    ReferenceVisitor visitor;
+    std::string error;
+    OBJAttributeCounts counts = objAttributeCountsAt(index, section.offset);
+    readOBJText(text.substr(section.offset, section.size), false, visitor, nullptr, error, OBJFaces, nullptr, nullptr, &counts);
+    visitor.finish(section, index);
+  }
+}
+
+//##################################################################################################
+OBJAttributeCounts objAttributeCountsAt(const OBJIndex& index, size_t offset)
+{
+  OBJAttributeCounts counts;
+
+  auto i = std::partition_point(index.blocks.begin(), index.blocks.end(), [&](const auto& block)
+  {
+    return block.offset<offset;
+  });
+
+  if(i!=index.blocks.begin())
+  {
+    const auto& block = *(i-1);
+    counts.positions = block.positions.end();
+    counts.texCoords = block.texCoords.end();
+    counts.normals   = block.normals  .end();
+  }
+
+  return counts;
+}
+
+//##################################################################################################
+std::string objIndexPath(const std::string& filePath,
+                         const std::string& cacheDirectory)
+{
+  std::string path = objCachePath(filePath, cacheDirectory);
+  return path.substr(0, path.size() - std::string_view(".tpobjcache").size()) + ".tpobjindex";
+}
+
+//##################################################################################################
+bool loadOBJIndex(const std::string& indexPath,
+                  const std::string& filePath,
+                  OBJIndex& index)
+{
+  MappedFile file(indexPath);
+  if(!file.isValid())
+    return false;
+
+  BinaryReader reader(file.text());
+  if(!checkHeader(reader, filePath))
+    return false;
+
+  OBJIndex result;
+  uint64_t positions=0;
+  uint64_t texCoords=0;
+  uint64_t normals=0;
+  uint64_t count=0;
+
+  if(!reader.readString(result.exporterVersion) || !reader.read(count))
+    return false;
+
+  for(uint64_t i=0; i<count; i++)
+    if(!reader.readString(result.materialLibraries.emplace_back()))
+      return false;
+
+  if(!reader.read(positions) || !reader.read(texCoords) || !reader.read(normals) || !reader.read(count))
+    return false;
+
+  result.positions = size_t(positions);
+  result.texCoords = size_t(texCoords);
+  result.normals = size_t(normals);
+
+  for(uint64_t i=0; i<count; i++)
+  {
+    auto& block = result.blocks.emplace_back();
+    uint64_t offset=0;
+    uint64_t size=0;
+    if(!reader.read(offset) ||
+       !reader.read(size) ||
+       !readRange(reader, block.positions) ||
+       !readRange(reader, block.texCoords) ||
+       !readRange(reader, block.normals))
+      return false;
+
+    block.offset = size_t(offset);
+    block.size = size_t(size);
+  }
+
+  if(!reader.read(count))
+    return false;
+
+  for(uint64_t i=0; i<count; i++)
+  {
+    auto& section = result.sections.emplace_back();
+    uint64_t offset=0;
+    uint64_t size=0;
+    uint64_t faces=0;
+    if(!reader.readString(section.object) ||
+       !reader.readString(section.group) ||
+       !reader.readString(section.material) ||
+       !reader.read(offset) ||
+       !reader.read(size) ||
+       !reader.read(faces) ||
+       !readRange(reader, section.positions) ||
+       !readRange(reader, section.texCoords) ||
+       !readRange(reader, section.normals))
+      return false;
+
+    section.offset = size_t(offset);
+    section.size = size_t(size);
+    section.faces = size_t(faces);
+  }
+
+  index = std::move(result);
+  return true;
+}
+
+//##################################################################################################
+bool saveOBJIndex(const std::string& indexPath,
+                  const std::string& filePath,
+                  const FileStamp& stamp,
+                  const OBJIndex& index)
+{
+  return writeBinaryFile(indexPath, [&](BinaryWriter& writer)
+  {
+    writeHeader(writer, filePath, stamp);
+
+    writer.writeString(index.exporterVersion);
+    writer.write(uint64_t(index.materialLibraries.size()));
+    for(const auto& library : index.materialLibraries)
+      writer.writeString(library);
+
+    writer.write(uint64_t(index.positions));
+    writer.write(uint64_t(index.texCoords));
+    writer.write(uint64_t(index.normals));
+
+    writer.write(uint64_t(index.blocks.size()));
+    for(const auto& block : index.blocks)
+    {
+      writer.write(uint64_t(block.offset));
+      writer.write(uint64_t(block.size));
+      writeRange(writer, block.positions);
+      writeRange(writer, block.texCoords);
+      writeRange(writer, block.normals);
+    }
+
+    writer.write(uint64_t(index.sections.size()));
+    for(const auto& section : index.sections)
+    {
+      writer.writeString(section.object);
+      writer.writeString(section.group);
+      writer.writeString(section.material);
+      writer.write(uint64_t(section.offset));
+      writer.write(uint64_t(section.size));
+      writer.write(uint64_t(section.faces));
+      writeRange(writer, section.positions);
+      writeRange(writer, section.texCoords);
+      writeRange(writer, section.normals);
+    }
+  });
+}
+
+}
@@ -0,0 +1,35 @@
+#include "tp_obj/OBJMeshBuffers.h"
+
+namespace tp_obj
+{
+
+//##################################################################################################
+bool OBJVertexLayout::isValid() const
+{
+  if(stride==0)
+    return true;
+
+  auto fits = [&](int offset, size_t size)
+  {
+    return offset<0 || size_t(offset)+size<=stride;
+  };
+
+  return fits(positionOffset, 3*sizeof(float)) &&
+         fits(texCoordOffset, 2*sizeof(float)) &&
+         fits(normalOffset  , 3*sizeof(float));
+}
+
+//##################################################################################################
+void OBJMeshBuffers::clear()
+{
+  vertexCount = 0;
+  positions.clear();
+  texCoords.clear();
+  normals.clear();
+  vertices.clear();
+  indexes.clear();
+  submeshes.clear();
+  materials.clear();
+}
+
+}
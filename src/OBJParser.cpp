@@ -1,604 +1,1693 @@
 #include "tp_obj/OBJParser.h"
-
-#include "tp_math_utils/materials/OpenGLMaterial.h"
-#include "tp_math_utils/materials/LegacyMaterial.h"
-#include "tp_math_utils/materials/ExternalMaterial.h"
+#include "tp_obj/OBJReader.h"
+#include "tp_obj/Tokenizer.h"
+#include "tp_obj/NumberParsing.h"
+#include "tp_obj/VertexIndexMap.h"
+#include "tp_obj/Parallel.h"
+#include "tp_obj/OBJStats.h"
+#include "tp_obj/OBJIndex.h"
+#include "tp_obj/Compression.h"
+#include "tp_obj/MaterialIndex.h"
+#include "tp_obj/MaterialPrefetch.h"
+#include "tp_obj/PolygonTriangulator.h"
+#include "tp_obj/OBJMeshBuffers.h"
+#include "tp_obj/VertexOrder.h"
+#include "tp_obj/VertexWeld.h"
 
 #include "tp_utils/FileUtils.h"
 #include "tp_utils/Progress.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <memory_resource>
+#include <unordered_map>
+
 namespace tp_obj
 {
 
-namespace
-{
+namespace
+{
+
+//##################################################################################################
+struct Attributes
+{
+  std::pmr::vector<glm::vec3> vv;
+  std::pmr::vector<glm::vec2> vt;
+  std::pmr::vector<glm::vec3> vn;
+
+  //################################################################################################
+  Attributes(std::pmr::memory_resource* resource):
+    vv(resource),
+    vt(resource),
+    vn(resource)
+  {
+
+  }
+
+  //################################################################################################
+  size_t memoryUsage() const
+  {
+    return vv.capacity()*sizeof(glm::vec3) + vt.capacity()*sizeof(glm::vec2) + vn.capacity()*sizeof(glm::vec3);
+  }
+};
+
+//##################################################################################################
+//! Where a GeometryBuilder writes the meshes that it builds.
+class MeshOutput
+{
+public:
+  //################################################################################################
+  virtual ~MeshOutput()=default;
+
+  //################################################################################################
+  //! Start a new object, verts are numbered from 0 in each object.
+  virtual void addObject(const std::string& objectName, const std::string& materialName)=0;
+
+  //################################################################################################
+  //! Start a new list of triangles in the current object.
+  virtual void addMesh()=0;
+
+  //################################################################################################
+  //! Add a vert to the current object and return its index, nullptr leaves an attribute at its default.
+  virtual int addVert(const glm::vec3& position, const glm::vec2* texCoord, const glm::vec3* normal)=0;
+
+  //################################################################################################
+  //! Add a triangle to the current mesh.
+  virtual void addTriangle(int a, int b, int c)=0;
+
+  //################################################################################################
+  //! Set the tex coord of a vert that was added before its tex coord was read.
+  virtual void setTexCoord(size_t object, size_t vert, const glm::vec2& texCoord)=0;
+
+  //################################################################################################
+  //! Set the normal of a vert that was added before its normal was read.
+  virtual void setNormal(size_t object, size_t vert, const glm::vec3& normal)=0;
+
+  //################################################################################################
+  virtual size_t objectCount() const=0;
+};
+
+//##################################################################################################
+//! Writes each object to a Geometry3D.
+class Geometry3DOutput : public MeshOutput
+{
+public:
+  //################################################################################################
+  Geometry3DOutput(int triangleFan, int triangleStrip, int triangles):
+    m_triangleFan(triangleFan),
+    m_triangleStrip(triangleStrip),
+    m_triangles(triangles)
+  {
+
+  }
+
+  //################################################################################################
+  void addObject(const std::string& objectName, const std::string& materialName) override
+  {
+    auto& o = geometry.emplace_back();
+    o.triangleFan   = m_triangleFan  ;
+    o.triangleStrip = m_triangleStrip;
+    o.triangles     = m_triangles    ;
+
+    if(!objectName.empty())
+    {
+      o.comments.push_back("MESH_NAME");
+      o.comments.push_back(objectName);
+    }
+
+    if(!materialName.empty())
+    {
+      o.comments.push_back("MATERIAL_NAME");
+      o.comments.push_back(materialName);
+    }
+
+    o.material.name = materialName;
+  }
+
+  //################################################################################################
+  void addMesh() override
+  {
+    auto& o = geometry.back();
+    m_mesh = &o.indexes.emplace_back().indexes;
+    o.indexes.back().type = o.triangles;
+  }
+
+  //################################################################################################
+  int addVert(const glm::vec3& position, const glm::vec2* texCoord, const glm::vec3* normal) override
+  {
+    auto& verts = geometry.back().verts;
+    auto& v = verts.emplace_back();
+    v.vert = position;
+
+    if(texCoord)
+      v.texture = *texCoord;
+
+    if(normal)
+      v.normal = *normal;
+
+    return int(verts.size()-1);
+  }
+
+  //################################################################################################
+  void addTriangle(int a, int b, int c) override
+  {
+    m_mesh->push_back(a);
+    m_mesh->push_back(b);
+    m_mesh->push_back(c);
+  }
+
+  //################################################################################################
+  void setTexCoord(size_t object, size_t vert, const glm::vec2& texCoord) override
+  {
+    geometry.at(object).verts.at(vert).texture = texCoord;
+  }
+
+  //################################################################################################
+  void setNormal(size_t object, size_t vert, const glm::vec3& normal) override
+  {
+    geometry.at(object).verts.at(vert).normal = normal;
+  }
+
+  //################################################################################################
+  size_t objectCount() const override
+  {
+    return geometry.size();
+  }
+
+  std::vector<tp_math_utils::Geometry3D> geometry;
+
+private:
+  int m_triangleFan;
+  int m_triangleStrip;
+  int m_triangles;
+  std::vector<int>* m_mesh{nullptr};
+};
+
+//##################################################################################################
+//! Writes all of the objects to a single set of vertex and index buffers.
+class BufferOutput : public MeshOutput
+{
+public:
+  //################################################################################################
+  BufferOutput(OBJMeshBuffers& buffers):
+    m_buffers(buffers),
+    m_interleaved(buffers.layout.stride>0)
+  {
+    m_buffers.clear();
+  }
+
+  //################################################################################################
+  void addObject(const std::string& objectName, const std::string& materialName) override
+  {
+    closeObject();
+
+    m_objectName = objectName;
+    m_objectFirstVertex = m_buffers.vertexCount;
+    m_objectFirstSubmesh = m_buffers.submeshes.size();
+    m_objectFirstVertexes.push_back(m_objectFirstVertex);
+
+    auto i = m_materialIDs.find(materialName);
+    if(i==m_materialIDs.end())
+    {
+      i = m_materialIDs.emplace(materialName, m_buffers.materials.size()).first;
+      m_buffers.materials.emplace_back().name = materialName;
+    }
+    m_materialID = i->second;
+  }
+
+  //################################################################################################
+  void addMesh() override
+  {
+    auto& submesh = m_buffers.submeshes.emplace_back();
+    submesh.name = m_objectName;
+    submesh.materialID = m_materialID;
+    submesh.firstIndex = m_buffers.indexes.size();
+    submesh.firstVertex = m_objectFirstVertex;
+  }
+
+  //################################################################################################
+  int addVert(const glm::vec3& position, const glm::vec2* texCoord, const glm::vec3* normal) override
+  {
+    size_t index = m_buffers.vertexCount++;
+
+    if(m_interleaved)
+    {
+      const auto& layout = m_buffers.layout;
+      m_buffers.vertices.resize(m_buffers.vertices.size() + layout.stride);
+      uint8_t* v = m_buffers.vertices.data() + index*layout.stride;
+      write(v, layout.positionOffset, position);
+      write(v, layout.texCoordOffset, texCoord?*texCoord:m_defaults.texture);
+      write(v, layout.normalOffset  , normal  ?*normal  :m_defaults.normal );
+    }
+    else
+    {
+      m_buffers.positions.push_back(position);
+      m_buffers.texCoords.push_back(texCoord?*texCoord:m_defaults.texture);
+      m_buffers.normals  .push_back(normal  ?*normal  :m_defaults.normal );
+    }
+
+    return int(index - m_objectFirstVertex);
+  }
+
+  //################################################################################################
+  void addTriangle(int a, int b, int c) override
+  {
+    auto base = uint32_t(m_objectFirstVertex);
+    m_buffers.indexes.push_back(base + uint32_t(a));
+    m_buffers.indexes.push_back(base + uint32_t(b));
+    m_buffers.indexes.push_back(base + uint32_t(c));
+  }
+
+  //################################################################################################
+  void setTexCoord(size_t object, size_t vert, const glm::vec2& texCoord) override
+  {
+    size_t index = m_objectFirstVertexes.at(object) + vert;
+    if(m_interleaved)
+      write(m_buffers.vertices.data() + index*m_buffers.layout.stride, m_buffers.layout.texCoordOffset, texCoord);
+    else
+      m_buffers.texCoords.at(index) = texCoord;
+  }
+
+  //################################################################################################
+  void setNormal(size_t object, size_t vert, const glm::vec3& normal) override
+  {
+    size_t index = m_objectFirstVertexes.at(object) + vert;
+    if(m_interleaved)
+      write(m_buffers.vertices.data() + index*m_buffers.layout.stride, m_buffers.layout.normalOffset, normal);
+    else
+      m_buffers.normals.at(index) = normal;
+  }
+
+  //################################################################################################
+  size_t objectCount() const override
+  {
+    return m_objectFirstVertexes.size();
+  }
+
+  //################################################################################################
+  //! Fill in the sizes of the last object and drop submeshes that have no triangles.
+  void finish()
+  {
+    closeObject();
+
+    auto& submeshes = m_buffers.submeshes;
+    submeshes.erase(std::remove_if(submeshes.begin(), submeshes.end(), [](const auto& submesh)
+    {
+      return submesh.indexCount==0;
+    }), submeshes.end());
+  }
+
+private:
+  //################################################################################################
+  template<typename T>
+  static void write(uint8_t* vertex, int offset, const T& value)
+  {
+    if(offset>=0)
+      std::memcpy(vertex+offset, &value, sizeof(T));
+  }
+
+  //################################################################################################
+  void closeObject()
+  {
+    auto& submeshes = m_buffers.submeshes;
+    for(size_t s=m_objectFirstSubmesh; s<submeshes.size(); s++)
+    {
+      auto& submesh = submeshes.at(s);
+      size_t end = (s+1<submeshes.size())?submeshes.at(s+1).firstIndex:m_buffers.indexes.size();
+      submesh.indexCount = end - submesh.firstIndex;
+      submesh.vertexCount = m_buffers.vertexCount - m_objectFirstVertex;
+    }
+    m_objectFirstSubmesh = submeshes.size();
+  }
+
+  OBJMeshBuffers& m_buffers;
+  bool m_interleaved;
+  tp_math_utils::Vertex3D m_defaults;
+
+  std::string m_objectName;
+  size_t m_objectFirstVertex{0};
+  size_t m_objectFirstSubmesh{0};
+  std::vector<size_t> m_objectFirstVertexes;
+
+  std::unordered_map<std::string, size_t> m_materialIDs;
+  size_t m_materialID{0};
+};
+
+//##################################################################################################
+//! Builds meshes from the object and face lines of an OBJ file.
+class GeometryBuilder
+{
+public:
+  //################################################################################################
+  GeometryBuilder(MeshOutput& output,
+                  const Attributes& attributes,
+                  std::pmr::memory_resource* resource):
+    m_output(output),
+    m_attributes(attributes),
+    m_indexes(resource),
+    m_pendingVerts(resource),
+    m_triangulator(resource),
+    m_polygonPoints(resource),
+    m_polygonVerts(resource)
+  {
+
+  }
+
+  //################################################################################################
+  void setObjectName(std::string name)
+  {
+    m_objectName = std::move(name);
+    m_newObject = true;
+    m_newMesh = true;
+  }
+
+  //################################################################################################
+  void setMaterialName(std::string name)
+  {
+    m_materialName = std::move(name);
+    m_newObject = true;
+    m_newMesh = true;
+  }
+
+  //################################################################################################
+  void setGroupName(std::string name, bool newMesh)
+  {
+    m_groupName = std::move(name);
+    if(newMesh)
+      m_newMesh = true;
+  }
+
+  //################################################################################################
+  //! Carry on from a point in the file whose names were set by lines that were not read.
+  /*!
+  The object and material are only changed if they differ so that sections of the same object are
+  still built into the same Geometry3D.
+  */
+  void resumeNames(const std::string& objectName, const std::string& materialName, const std::string& groupName)
+  {
+    if(objectName != m_objectName)
+      setObjectName(objectName);
+
+    if(materialName != m_materialName)
+      setMaterialName(materialName);
+
+    setGroupName(groupName, true);
+  }
+
+  //################################################################################################
+  //! Returns true if all positions referenced by the corners have been read.
+  bool canResolve(const std::vector<OBJCorner>& corners) const
+  {
+    for(const auto& corner : corners)
+      if(corner.valid && corner.vvi>=m_attributes.vv.size())
+        return false;
+    return true;
+  }
+
+  //################################################################################################
+  void addFace(const std::vector<OBJCorner>& corners)
+  {
+    if(corners.size()<3)
+      return;
+
+    if(m_newObject)
+    {
+      m_newObject = false;
+      m_indexes.clear();
+      m_output.addObject(m_objectName, m_materialName);
+    }
+
+    if(m_newMesh)
+    {
+      m_newMesh = false;
+      m_output.addMesh();
+    }
+
+    if(corners.size()>4)
+    {
+      addPolygon(corners);
+      return;
+    }
+
+    int a = addVert(corners[0]);
+    int b = addVert(corners[1]);
+    int c = addVert(corners[2]);
+
+    if(a<0 || b<0 || c<0)
+      return;
+
+    m_output.addTriangle(a, b, c);
+
+    // If its a quad we need to add an extra polygon.
+    if(corners.size()>3)
+    {
+      int d = addVert(corners[3]);
+      if(d<0)
+        return;
+
+      m_output.addTriangle(c, d, a);
+    }
+  }
+
+  //################################################################################################
+  //! Fill in tex coords and normals that were read after the verts that use them.
+  void finish()
+  {
+    for(const auto& p : m_pendingVerts)
+    {
+      if(p.vti<m_attributes.vt.size())
+        m_output.setTexCoord(p.object, p.vert, m_attributes.vt.at(p.vti));
+
+      if(p.vni<m_attributes.vn.size())
+        m_output.setNormal(p.object, p.vert, m_attributes.vn.at(p.vni));
+    }
+
+    m_pendingVerts.clear();
+  }
+
+  //################################################################################################
+  //! Bytes held by the vertex map and the list of pending verts.
+  size_t memoryUsage() const
+  {
+    return m_indexes.memoryUsage() + m_pendingVerts.capacity()*sizeof(PendingVert);
+  }
+
+  size_t cornerLookups{0};
+  size_t cornerHits{0};
+  size_t convexPolygons{0};
+  size_t concavePolygons{0};
+
+private:
+  //################################################################################################
+  //! Triangulate a face with more than 4 corners, the whole face is dropped if a corner is invalid.
+  void addPolygon(const std::vector<OBJCorner>& corners)
+  {
+    m_polygonPoints.clear();
+    for(const auto& corner : corners)
+    {
+      if(!corner.valid || corner.vvi>=m_attributes.vv.size())
+        return;
+      m_polygonPoints.push_back(m_attributes.vv[corner.vvi]);
+    }
+
+    if(m_triangulator.triangulate(m_polygonPoints.data(), m_polygonPoints.size()))
+      convexPolygons++;
+    else
+      concavePolygons++;
+
+    m_polygonVerts.clear();
+    for(const auto& corner : corners)
+      m_polygonVerts.push_back(addVert(corner));
+
+    const auto& triangles = m_triangulator.triangles();
+    for(size_t i=0; i+2<triangles.size(); i+=3)
+      m_output.addTriangle(m_polygonVerts[triangles[i]], m_polygonVerts[triangles[i+1]], m_polygonVerts[triangles[i+2]]);
+  }
+
+  //################################################################################################
+  int addVert(const OBJCorner& corner)
+  {
+    if(!corner.valid)
+      return -1;
+
+    const auto& [vvi, vti, vni, valid] = corner;
+
+    cornerLookups++;
+    if(int i = m_indexes.find(vvi, vti, vni); i>=0)
+    {
+      cornerHits++;
+      return i;
+    }
+
+    if(vvi>=m_attributes.vv.size())
+      return -1;
+
+    const glm::vec2* texCoord = (vti<m_attributes.vt.size())?&m_attributes.vt[vti]:nullptr;
+    const glm::vec3* normal = (vni<m_attributes.vn.size())?&m_attributes.vn[vni]:nullptr;
+
+    int index = m_output.addVert(m_attributes.vv[vvi], texCoord, normal);
+
+    if(!texCoord || !normal)
+      m_pendingVerts.push_back({m_output.objectCount()-1, size_t(index), vti, vni});
+
+    m_indexes.insert(vvi, vti, vni, index);
+    return index;
+  }
+
+  MeshOutput& m_output;
+  const Attributes& m_attributes;
+
+  std::string m_materialName;
+  std::string m_objectName;
+  std::string m_groupName;
+  bool m_newObject{true};
+  bool m_newMesh{true};
+
+  VertexIndexMap m_indexes;
+
+  // Verts that reference tex coords or normals further down the file, filled in by finish().
+  struct PendingVert
+  {
+    size_t object;
+    size_t vert;
+    size_t vti;
+    size_t vni;
+  };
+  std::pmr::vector<PendingVert> m_pendingVerts;
+
+  // Kept between faces so polygons don't allocate once the buffers have grown.
+  PolygonTriangulator m_triangulator;
+  std::pmr::vector<glm::vec3> m_polygonPoints;
+  std::pmr::vector<int> m_polygonVerts;
+};
+
+//##################################################################################################
+//! Object and face lines kept in file order to be passed to a GeometryBuilder later.
+class ObjectRecords
+{
+public:
+  //################################################################################################
+  ObjectRecords(std::pmr::memory_resource* resource):
+    m_records(resource),
+    m_corners(resource),
+    m_names(resource)
+  {
+
+  }
+
+  //################################################################################################
+  bool empty() const
+  {
+    return m_records.empty();
+  }
+
+  //################################################################################################
+  void addObjectName(const std::string& name)
+  {
+    addName(Type::Object, name);
+  }
+
+  //################################################################################################
+  void addMaterialName(const std::string& name)
+  {
+    addName(Type::Material, name);
+  }
+
+  //################################################################################################
+  void addGroupName(const std::string& name, bool newMesh)
+  {
+    addName(newMesh?Type::Group:Type::Smoothing, name);
+  }
+
+  //################################################################################################
+  void addFace(const std::vector<OBJCorner>& corners)
+  {
+    m_records.push_back({Type::Face, m_corners.size(), corners.size()});
+    m_corners.insert(m_corners.end(), corners.begin(), corners.end());
+  }
+
+  //################################################################################################
+  //! Pass the records to the builder in order and release them.
+  void replay(GeometryBuilder& builder)
+  {
+    std::vector<OBJCorner> corners;
+    for(const auto& record : m_records)
+    {
+      auto name = [&]
+      {
+        return std::string(m_names, record.first, record.count);
+      };
+
+      switch(record.type)
+      {
+      case Type::Object:    builder.setObjectName(name());       break;
+      case Type::Material:  builder.setMaterialName(name());     break;
+      case Type::Group:     builder.setGroupName(name(), true);  break;
+      case Type::Smoothing: builder.setGroupName(name(), false); break;
+      case Type::Face:
+      {
+        auto first = m_corners.begin()+std::ptrdiff_t(record.first);
+        corners.assign(first, first+std::ptrdiff_t(record.count));
+        builder.addFace(corners);
+        break;
+      }
+      }
+    }
+
+    m_records.clear();
+    m_records.shrink_to_fit();
+    m_corners.clear();
+    m_corners.shrink_to_fit();
+    m_names.clear();
+    m_names.shrink_to_fit();
+  }
+
+  //################################################################################################
+  size_t memoryUsage() const
+  {
+    return m_records.capacity()*sizeof(Record) + m_corners.capacity()*sizeof(OBJCorner) + m_names.capacity();
+  }
+
+private:
+  enum class Type
+  {
+    Object,
+    Material,
+    Group,
+    Smoothing,
+    Face
+  };
+
+  //! Names are kept in m_names and corners in m_corners, first and count locate them.
+  struct Record
+  {
+    Type type;
+    size_t first;
+    size_t count;
+  };
+
+  //################################################################################################
+  void addName(Type type, const std::string& name)
+  {
+    m_records.push_back({type, m_names.size(), name.size()});
+    m_names += name;
+  }
+
+  std::pmr::vector<Record> m_records;
+  std::pmr::vector<OBJCorner> m_corners;
+  std::pmr::string m_names;
+};
+
+//##################################################################################################
+//! Collects the attributes and material libraries of an OBJ file.
+class AttributeVisitor : public OBJVisitor
+{
+public:
+  //################################################################################################
+  AttributeVisitor(std::pmr::memory_resource* resource):
+    attributes(resource)
+  {
+
+  }
+
+  //################################################################################################
+  void vertex(const glm::vec3& position) override
+  {
+    attributes.vv.push_back(position);
+  }
+
+  //################################################################################################
+  void texCoord(const glm::vec2& texCoord) override
+  {
+    attributes.vt.push_back(texCoord);
+  }
+
+  //################################################################################################
+  void normal(const glm::vec3& normal) override
+  {
+    attributes.vn.push_back(normal);
+  }
+
+  //################################################################################################
+  void materialLibrary(const std::string& fileName) override
+  {
+    materialLibraries.push_back(fileName);
+  }
+
+  Attributes attributes;
+  std::vector<std::string> materialLibraries;
+};
+
+//##################################################################################################
+//! Records the object and face lines of an OBJ file.
+class RecordVisitor : public OBJVisitor
+{
+public:
+  //################################################################################################
+  RecordVisitor(std::pmr::memory_resource* resource):
+    records(resource)
+  {
+
+  }
+
+  //################################################################################################
+  void face(const std::vector<OBJCorner>& corners) override
+  {
+    records.addFace(corners);
+  }
+
+  //################################################################################################
+  void object(const std::string& name) override
+  {
+    records.addObjectName(name);
+  }
+
+  //################################################################################################
+  void group(const std::string& name) override
+  {
+    records.addGroupName(name, true);
+  }
+
+  //################################################################################################
+  void smoothingGroup(const std::string& name) override
+  {
+    records.addGroupName(name, false);
+  }
+
+  //################################################################################################
+  void material(const std::string& name) override
+  {
+    records.addMaterialName(name);
+  }
+
+  ObjectRecords records;
+};
+
+//##################################################################################################
+//! Builds meshes as the file is read in a single pass.
+/*!
+Once a face references a position further down the file it and all object and face lines that
+follow it are recorded and passed to the builder at the end, this preserves the order that verts
+are added in.
+*/
+class GeometryVisitor : public AttributeVisitor
+{
+public:
+  //################################################################################################
+  GeometryVisitor(MeshOutput& output, std::pmr::memory_resource* resource):
+    AttributeVisitor(resource),
+    builder(output, attributes, resource),
+    m_deferred(resource)
+  {
+
+  }
+
+  //################################################################################################
+  void face(const std::vector<OBJCorner>& corners) override
+  {
+    if(m_deferred.empty() && builder.canResolve(corners))
+      builder.addFace(corners);
+    else
+      m_deferred.addFace(corners);
+  }
+
+  //################################################################################################
+  void object(const std::string& name) override
+  {
+    if(m_deferred.empty())
+      builder.setObjectName(name);
+    else
+      m_deferred.addObjectName(name);
+  }
+
+  //################################################################################################
+  void group(const std::string& name) override
+  {
+    if(m_deferred.empty())
+      builder.setGroupName(name, true);
+    else
+      m_deferred.addGroupName(name, true);
+  }
+
+  //################################################################################################
+  void smoothingGroup(const std::string& name) override
+  {
+    if(m_deferred.empty())
+      builder.setGroupName(name, false);
+    else
+      m_deferred.addGroupName(name, false);
+  }
+
+  //################################################################################################
+  void material(const std::string& name) override
+  {
+    if(m_deferred.empty())
+      builder.setMaterialName(name);
+    else
+      m_deferred.addMaterialName(name);
+  }
+
+  //################################################################################################
+  void finish()
+  {
+    m_deferred.replay(builder);
+    builder.finish();
+  }
+
+  //################################################################################################
+  size_t memoryUsage() const
+  {
+    return attributes.memoryUsage() + builder.memoryUsage() + m_deferred.memoryUsage();
+  }
+
+  GeometryBuilder builder;
+
+private:
+  ObjectRecords m_deferred;
+};
+
+//##################################################################################################
+//! A range of lines of a file that is parsed on its own thread.
+struct Chunk
+{
+  //################################################################################################
+  Chunk(std::pmr::memory_resource* upstream):
+    attributeArena(upstream),
+    recordArena(upstream),
+    attributes(std::make_unique<AttributeVisitor>(&attributeArena)),
+    records(&recordArena)
+  {
+
+  }
+
+  // The attributes are released as soon as they have been joined, before the records are used.
+  std::pmr::monotonic_buffer_resource attributeArena;
+  std::pmr::monotonic_buffer_resource recordArena;
+
+  std::string_view text;
+  std::unique_ptr<AttributeVisitor> attributes;
+  RecordVisitor records;
+  std::string exporterVersion;
+  std::string error;
+  bool failed{false};
+  OBJStats stats;
+};
 
 //##################################################################################################
-std::string joinName(const std::vector<std::string>& parts)
+//! Split text into about count chunks that start and end on line boundaries.
+std::vector<std::unique_ptr<Chunk>> splitChunks(std::string_view text, size_t count, std::pmr::memory_resource* upstream)
 {
-  std::string name;
-  for(size_t i=1; i<parts.size(); i++)
+  std::vector<std::unique_ptr<Chunk>> chunks;
+  chunks.reserve(count);
+
+  size_t begin=0;
+  for(size_t i=1; i<=count && begin<text.size(); i++)
   {
-    if(!name.empty())
-      name+=' ';
-    name += parts.at(i);
+    size_t end = text.size();
+    if(i<count)
+    {
+      end = std::max(begin, (text.size()/count)*i);
+      end = text.find('\n', end);
+      end = (end==std::string_view::npos)?text.size():end+1;
+    }
+
+    chunks.emplace_back(new Chunk(upstream))->text = text.substr(begin, end-begin);
+    begin = end;
   }
-  return name;
+
+  return chunks;
 }
 
 //##################################################################################################
-bool readBool(const std::string& s)
+//! Parse the file in chunks on several threads.
+/*!
+First each chunk reads its attributes, these are joined using the prefix sums of the counts. Then
+the face lines of each batch of chunks are decoded in parallel and passed to the builder in file
+order, which keeps the output identical to parsing on a single thread.
+*/
+bool parseParallel(std::string_view text,
+                   size_t threadCount,
+                   bool reverse,
+                   std::string& exporterVersion,
+                   Attributes& attributes,
+                   GeometryBuilder& builder,
+                   std::vector<std::string>& materialLibraries,
+                   std::string& error,
+                   OBJStats* stats,
+                   tp_utils::Progress* progress,
+                   std::pmr::memory_resource* upstream)
 {
-  auto ss = tpToLower(s);
+  // Progress is not thread safe so it is only updated and checked between the phases.
+  auto cancelled = [&](float fraction)
+  {
+    if(!progress)
+      return false;
+
+    progress->setProgress(fraction);
+    if(!progress->shouldStop())
+      return false;
+
+    error = "Cancelled.";
+    return true;
+  };
+
+  std::vector<std::unique_ptr<Chunk>> chunks = splitChunks(text, threadCount*4, upstream);
+
+  //-- Read attributes -----------------------------------------------------------------------------
+  parallelFor(chunks.size(), threadCount, [&](size_t c)
+  {
+    Chunk& chunk = *chunks.at(c);
+    chunk.failed = !readOBJText(chunk.text,
+                                reverse,
+                                *chunk.attributes,
+                                &chunk.exporterVersion,
+                                chunk.error,
+                                OBJAttributes | OBJMaterialLibraries,
+                                stats?&chunk.stats:nullptr);
+  });
+
+  for(const auto& chunk : chunks)
+  {
+    if(chunk->failed)
+    {
+      error = chunk->error;
+      return false;
+    }
+  }
 
-  if(ss == "0" || ss == "false")
+  if(cancelled(0.4f))
     return false;
 
+  //-- Join attributes -----------------------------------------------------------------------------
+  // The number of each attribute before each chunk, also used to resolve negative face indexes.
+  std::vector<size_t> vvOffsets{0};
+  std::vector<size_t> vtOffsets{0};
+  std::vector<size_t> vnOffsets{0};
+  {
+    size_t chunkBytes=0;
+    for(const auto& chunk : chunks)
+    {
+      const Attributes& a = chunk->attributes->attributes;
+      vvOffsets.push_back(vvOffsets.back() + a.vv.size());
+      vtOffsets.push_back(vtOffsets.back() + a.vt.size());
+      vnOffsets.push_back(vnOffsets.back() + a.vn.size());
+
+      const auto& libraries = chunk->attributes->materialLibraries;
+      materialLibraries.insert(materialLibraries.end(), libraries.begin(), libraries.end());
+
+      if(!chunk->exporterVersion.empty())
+        exporterVersion = chunk->exporterVersion;
+
+      chunkBytes += a.memoryUsage();
+    }
+
+    attributes.vv.resize(vvOffsets.back());
+    attributes.vt.resize(vtOffsets.back());
+    attributes.vn.resize(vnOffsets.back());
+
+    // While copying both the chunk attributes and the joined attributes are held.
+    if(stats)
+      stats->peakTemporaryBytes = std::max(stats->peakTemporaryBytes, chunkBytes + attributes.memoryUsage());
+
+    parallelFor(chunks.size(), threadCount, [&](size_t c)
+    {
+      Chunk& chunk = *chunks.at(c);
+      const Attributes& a = chunk.attributes->attributes;
+      std::copy(a.vv.begin(), a.vv.end(), attributes.vv.begin()+std::ptrdiff_t(vvOffsets.at(c)));
+      std::copy(a.vt.begin(), a.vt.end(), attributes.vt.begin()+std::ptrdiff_t(vtOffsets.at(c)));
+      std::copy(a.vn.begin(), a.vn.end(), attributes.vn.begin()+std::ptrdiff_t(vnOffsets.at(c)));
+      chunk.attributes.reset();
+      chunk.attributeArena.release();
+    });
+  }
+
+  //-- Decode and resolve faces --------------------------------------------------------------------
+  for(size_t batch=0; batch<chunks.size(); batch+=threadCount)
+  {
+    size_t batchSize = std::min(threadCount, chunks.size()-batch);
+
+    parallelFor(batchSize, threadCount, [&](size_t c)
+    {
+      Chunk& chunk = *chunks.at(batch+c);
+      std::string unused;
+
+      OBJAttributeCounts counts;
+      counts.positions = vvOffsets.at(batch+c);
+      counts.texCoords = vtOffsets.at(batch+c);
+      counts.normals   = vnOffsets.at(batch+c);
+
+      // The lines and bytes were counted while reading the attributes.
+      OBJStats faceStats;
+      readOBJText(chunk.text, reverse, chunk.records, nullptr, unused, OBJFaces | OBJObjects, stats?&faceStats:nullptr, nullptr, &counts);
+      chunk.stats.tokenizeSeconds += faceStats.tokenizeSeconds;
+      chunk.stats.faceSeconds += faceStats.faceSeconds;
+      chunk.stats.faces += faceStats.faces;
+      chunk.stats.invalidCorners += faceStats.invalidCorners;
+    });
+
+    if(stats)
+    {
+      size_t recordBytes=0;
+      for(size_t c=batch; c<batch+batchSize; c++)
+        recordBytes += chunks.at(c)->records.records.memoryUsage();
+
+      size_t bytes = attributes.memoryUsage() + builder.memoryUsage() + recordBytes;
+      stats->peakTemporaryBytes = std::max(stats->peakTemporaryBytes, bytes);
+    }
+
+    {
+      OBJStatsTimer timer(stats?&stats->faceSeconds:nullptr);
+      for(size_t c=batch; c<batch+batchSize; c++)
+      {
+        if(stats)
+          stats->add(chunks.at(c)->stats);
+        chunks.at(c)->records.records.replay(builder);
+        chunks.at(c).reset();
+      }
+    }
+
+    if(cancelled(0.4f + 0.6f*float(batch+batchSize)/float(chunks.size())))
+      return false;
+  }
+
   return true;
 }
 
 //##################################################################################################
-float readFloat(const std::string& s)
+//! The part of each kind of attribute that is loaded for a set of sections.
+struct AttributeSpans
 {
-  float v;
-  std::istringstream istr(s);
-  istr.imbue(std::locale("C"));
-  istr >> v;
-  return v;
-}
+  OBJIndexRange positions;
+  OBJIndexRange texCoords;
+  OBJIndexRange normals;
+
+  //################################################################################################
+  void add(const OBJSection& section)
+  {
+    join(positions, section.positions);
+    join(texCoords, section.texCoords);
+    join(normals  , section.normals  );
+  }
+
+private:
+  //################################################################################################
+  static void join(OBJIndexRange& span, const OBJIndexRange& range)
+  {
+    if(range.count==0)
+      return;
+
+    if(span.count==0)
+    {
+      span = range;
+      return;
+    }
+
+    size_t end = std::max(span.end(), range.end());
+    span.first = std::min(span.first, range.first);
+    span.count = end - span.first;
+  }
+};
 
 //##################################################################################################
-int readInt(const std::string& s)
+//! Mark the blocks that hold part of a range, blocks are in file order so their ranges are sorted.
+void markBlocks(const std::vector<OBJAttributeBlock>& blocks,
+                const OBJIndexRange& range,
+                OBJIndexRange OBJAttributeBlock::* member,
+                std::vector<bool>& marked)
 {
-  int n=0;
-  tpNumber(s, n);
-  return n;
-}
+  if(range.count==0)
+    return;
+
+  auto i = std::partition_point(blocks.begin(), blocks.end(), [&](const auto& block)
+  {
+    return (block.*member).end()<=range.first;
+  });
 
+  for(; i!=blocks.end() && ((*i).*member).first<range.end(); ++i)
+    if(((*i).*member).overlaps(range))
+      marked.at(size_t(i-blocks.begin())) = true;
 }
 
 //##################################################################################################
-std::vector<std::vector<std::string>> parseLines(const std::string& filePath, std::string* exporterVersion)
+//! Stores the attributes of a block that fall within the spans, relative to the start of the spans.
+class BlockVisitor : public OBJVisitor
 {
-  std::vector<std::vector<std::string>> lines;
+public:
+  //################################################################################################
+  BlockVisitor(const OBJAttributeBlock& block, const AttributeSpans& spans, Attributes& attributes):
+    m_vvi(block.positions.first),
+    m_vti(block.texCoords.first),
+    m_vni(block.normals.first),
+    m_spans(spans),
+    m_attributes(attributes)
+  {
+
+  }
 
-  auto splitLine = [](std::string line, std::string* exporterVersion)
+  //################################################################################################
+  void vertex(const glm::vec3& position) override
   {
-    std::vector<std::string> parts;
-    if(auto i=line.find_first_of('#'); i!=std::string::npos)
+    if(size_t i=m_vvi++; i>=m_spans.positions.first && i<m_spans.positions.end())
+      m_attributes.vv[i-m_spans.positions.first] = position;
+  }
+
+  //################################################################################################
+  void texCoord(const glm::vec2& texCoord) override
+  {
+    if(size_t i=m_vti++; i>=m_spans.texCoords.first && i<m_spans.texCoords.end())
+      m_attributes.vt[i-m_spans.texCoords.first] = texCoord;
+  }
+
+  //################################################################################################
+  void normal(const glm::vec3& normal) override
+  {
+    if(size_t i=m_vni++; i>=m_spans.normals.first && i<m_spans.normals.end())
+      m_attributes.vn[i-m_spans.normals.first] = normal;
+  }
+
+private:
+  size_t m_vvi;
+  size_t m_vti;
+  size_t m_vni;
+  const AttributeSpans& m_spans;
+  Attributes& m_attributes;
+};
+
+//##################################################################################################
+//! Passes the object and face lines of sections to a builder with the indexes moved to the spans.
+class SectionVisitor : public OBJVisitor
+{
+public:
+  //################################################################################################
+  SectionVisitor(GeometryBuilder& builder, const AttributeSpans& spans):
+    m_builder(builder),
+    m_spans(spans)
+  {
+
+  }
+
+  //################################################################################################
+  void face(const std::vector<OBJCorner>& corners) override
+  {
+    // Corners past the end of the file stay past the end of the spans so they are treated the same.
+    m_corners = corners;
+    for(auto& corner : m_corners)
     {
-      if(nullptr != exporterVersion)
-      {
-        const std::string exporterVersionPrefix = "# OMI OBJ exporter v";
-        if(0 == line.rfind(exporterVersionPrefix, 0))
-          *exporterVersion = line.substr(exporterVersionPrefix.size());
-      }
+      if(!corner.valid)
+        continue;
 
-      line.erase(i);
+      corner.vvi -= m_spans.positions.first;
+      corner.vti -= m_spans.texCoords.first;
+      corner.vni -= m_spans.normals.first;
     }
 
-    line.erase(0, line.find_first_not_of(" \t\n\r\f\v"));
+    m_builder.addFace(m_corners);
+  }
+
+  //################################################################################################
+  void object(const std::string& name) override
+  {
+    m_builder.setObjectName(name);
+  }
 
-    tpSplit(parts, line, ' ', TPSplitBehavior::SkipEmptyParts);
-    return parts;
-  };
+  //################################################################################################
+  void group(const std::string& name) override
+  {
+    m_builder.setGroupName(name, true);
+  }
 
-  std::vector<std::string> rawLines;
-  std::string text = tp_utils::readTextFile(filePath);
-  tpRemoveChar(text, '\r');
-  tpSplit(rawLines, text, '\n', TPSplitBehavior::SkipEmptyParts);
+  //################################################################################################
+  void smoothingGroup(const std::string& name) override
+  {
+    m_builder.setGroupName(name, false);
+  }
 
-  lines.reserve(rawLines.size());
-  for(const auto& line : rawLines)
-    if(std::vector<std::string> parts = splitLine(line, exporterVersion); !parts.empty())
-      lines.push_back(parts);
+  //################################################################################################
+  void material(const std::string& name) override
+  {
+    m_builder.setMaterialName(name);
+  }
 
-  return lines;
-}
+private:
+  GeometryBuilder& m_builder;
+  const AttributeSpans& m_spans;
+  std::vector<OBJCorner> m_corners;
+};
 
 //##################################################################################################
-bool parseOBJ(const std::string& filePath,
-              int triangleFan,
-              int triangleStrip,
-              int triangles,
-              bool reverse,
-              std::string& exporterVersion,
-              std::vector<tp_math_utils::Geometry3D>& outputGeometry,
-              tp_utils::Progress* progress)
+//! Parse the geometry of a file into an output, see parseOBJGeometry.
+bool parseGeometry(const std::string& filePath,
+                   bool reverse,
+                   std::string& exporterVersion,
+                   MeshOutput& output,
+                   std::vector<std::string>& materialLibraries,
+                   tp_utils::Progress* progress,
+                   const ParseOptions& options)
 {
+  OBJStats* stats = options.stats;
+  OBJStatsTimer totalTimer(stats?&stats->totalSeconds:nullptr);
+
   auto barf = [&](auto msg)
   {
-    progress->addError("Parse OBJ error: ");
-    progress->addError(msg);
+    if(options.error)
+      *options.error = msg;
+
+    if(progress)
+    {
+      progress->addError("Parse OBJ error: ");
+      progress->addError(msg);
+    }
     return false;
   };
 
   if(!tp_utils::exists(filePath))
     return barf("file doesn't exist: " + filePath);
 
-  std::vector<std::vector<std::string>> lines = parseLines(filePath, &exporterVersion);
+  std::unique_ptr<MappedFile> mappedFile;
+  {
+    OBJStatsTimer ioTimer(stats?&stats->ioSeconds:nullptr);
+    mappedFile = std::make_unique<MappedFile>(filePath);
+  }
+  const MappedFile& file = *mappedFile;
+
+  // Compressed files are decompressed in blocks as they are parsed so they can't be split.
+  size_t threadCount = resolveThreadCount(options.threadCount);
+  if(file.text().size()<options.parallelThreshold || detectCompression(file.text())!=Compression::None)
+    threadCount = 1;
 
-  std::vector<glm::vec3> objVV;
-  std::vector<glm::vec2> objVT;
-  std::vector<glm::vec3> objVN;
-  std::vector<tp_math_utils::Material> objMaterials;
+  std::vector<std::string> libraries;
+  std::string error;
 
-  //-- Reserve -----------------------------------------------------------------------------------
+  // Everything the parse allocates apart from the output is freed in one go with the arena.
+  std::pmr::memory_resource* upstream = options.memoryResource?options.memoryResource:std::pmr::get_default_resource();
+  std::pmr::monotonic_buffer_resource arena(upstream);
+
+  if(threadCount>1)
   {
-    size_t objVVCount=0;
-    size_t objVTCount=0;
-    size_t objVNCount=0;
-    for(const auto& parts : lines)
+    Attributes attributes(&arena);
+    GeometryBuilder builder(output, attributes, &arena);
+
+    if(!parseParallel(file.text(), threadCount, reverse, exporterVersion, attributes, builder, libraries, error, stats, progress, upstream))
+      return barf(error);
+
+    builder.finish();
+
+    if(stats)
     {
-      std::string c = parts.front();
-      if     (c == "v" ) objVVCount++;
-      else if(c == "vt") objVTCount++;
-      else if(c == "vn") objVNCount++;
+      stats->cornerLookups += builder.cornerLookups;
+      stats->cornerHits += builder.cornerHits;
+      stats->convexPolygons += builder.convexPolygons;
+      stats->concavePolygons += builder.concavePolygons;
     }
-
-    objVV.reserve(objVVCount);
-    objVT.reserve(objVTCount);
-    objVN.reserve(objVNCount);
   }
-
-  //-- Extract verts, tex coords, and normals ------------------------------------------------------
-  try
+  else
   {
-    for(const auto& parts : lines)
+    GeometryVisitor visitor(output, &arena);
+
+    // A rough guess from the file size, the vectors still grow if the file is denser than this.
+    // Only positions are reserved as a file may not have texture coordinates or normals, and the
+    // arena would keep the unused storage. The size of a compressed file says little about how
+    // many positions it holds so they just grow.
+    if(detectCompression(file.text())==Compression::None)
+      visitor.attributes.vv.reserve(file.text().size()/128);
+
+    if(!readOBJData(file.text(), reverse, visitor, &exporterVersion, error, OBJAll, stats, progress))
+      return barf(error);
+
     {
-      std::string c = parts.front();
-      if(c == "v")
-      {
-        if(parts.size()<4)
-          return barf("v should have 4 parts.");
+      OBJStatsTimer timer(stats?&stats->faceSeconds:nullptr);
+      visitor.finish();
+    }
 
-        glm::vec3& v = objVV.emplace_back();
+    if(stats)
+    {
+      stats->peakTemporaryBytes = std::max(stats->peakTemporaryBytes, visitor.memoryUsage());
+      stats->cornerLookups += visitor.builder.cornerLookups;
+      stats->cornerHits += visitor.builder.cornerHits;
+      stats->convexPolygons += visitor.builder.convexPolygons;
+      stats->concavePolygons += visitor.builder.concavePolygons;
+    }
 
-        v.x = std::stof(parts.at(1));
-        v.y = std::stof(parts.at(2));
-        v.z = std::stof(parts.at(3));
+    libraries = std::move(visitor.materialLibraries);
+  }
 
-        if(glm::any(glm::isnan(v)))
-          return barf("v NaN.");
+  for(const auto& library : libraries)
+    materialLibraries.push_back(tp_utils::pathAppend(tp_utils::directoryName(filePath), library));
 
-        if(glm::any(glm::isinf(v)))
-          return barf("v inf.");
-      }
+  return true;
+}
 
-      else if(c == "vt")
-      {
-        if(parts.size()<3)
-          return barf("vt should have 3 parts.");
 
-        glm::vec2& v = objVT.emplace_back();
+}
 
-        v.x = std::stof(parts.at(1));
-        v.y = std::stof(parts.at(2));
+//##################################################################################################
+std::vector<std::vector<std::string>> parseLines(const std::string& filePath, std::string* exporterVersion)
+{
+  std::vector<std::vector<std::string>> lines;
 
-        if(glm::any(glm::isnan(v)))
-          return barf("v NaN.");
+  MappedFile file(filePath);
+  std::string error;
+  forEachTextBlock(file.text(), [&](std::string_view text, float)
+  {
+    LineTokenizer tokenizer(text, exporterVersion);
+    while(tokenizer.next())
+    {
+      auto& parts = lines.emplace_back();
+      parts.reserve(tokenizer.parts().size());
+      for(const auto& part : tokenizer.parts())
+        parts.emplace_back(part);
+    }
+    return true;
+  }, error);
 
-        if(glm::any(glm::isinf(v)))
-          return barf("v inf.");
+  return lines;
+}
 
-        if(reverse)
-          v.y = 1.0f-v.y;
-      }
+//##################################################################################################
+bool parseOBJ(const std::string& filePath,
+              int triangleFan,
+              int triangleStrip,
+              int triangles,
+              bool reverse,
+              std::string& exporterVersion,
+              std::vector<tp_math_utils::Geometry3D>& outputGeometry,
+              tp_utils::Progress* progress,
+              const ParseOptions& options)
+{
+  MaterialPrefetch prefetch(filePath, options.prefetchMaterials);
+
+  std::vector<tp_math_utils::Geometry3D> geometry;
+  std::vector<std::string> materialLibraries;
+
+  if(!parseOBJGeometry(filePath,
+                       triangleFan,
+                       triangleStrip,
+                       triangles,
+                       reverse,
+                       exporterVersion,
+                       geometry,
+                       materialLibraries,
+                       progress,
+                       options))
+    return false;
 
-      else if(c == "vn")
-      {
-        if(parts.size()<4)
-          return barf("vn should have 4 parts.");
+  prefetch.join(options.stats);
+  assignMaterials(materialLibraries, geometry, progress, options.stats, options.sharedMaterials);
 
-        glm::vec3& v = objVN.emplace_back();
+  outputGeometry.reserve(outputGeometry.size() + geometry.size());
+  for(auto& o : geometry)
+    outputGeometry.push_back(std::move(o));
 
-        v.x = std::stof(parts.at(1));
-        v.y = std::stof(parts.at(2));
-        v.z = std::stof(parts.at(3));
+  return true;
+}
 
-        if(glm::any(glm::isnan(v)))
-          return barf("v NaN.");
+//##################################################################################################
+bool parseOBJGeometry(const std::string& filePath,
+                      int triangleFan,
+                      int triangleStrip,
+                      int triangles,
+                      bool reverse,
+                      std::string& exporterVersion,
+                      std::vector<tp_math_utils::Geometry3D>& outputGeometry,
+                      std::vector<std::string>& materialLibraries,
+                      tp_utils::Progress* progress,
+                      const ParseOptions& options)
+{
+  Geometry3DOutput output(triangleFan, triangleStrip, triangles);
+  if(!parseGeometry(filePath, reverse, exporterVersion, output, materialLibraries, progress, options))
+    return false;
 
-        if(glm::any(glm::isinf(v)))
-          return barf("v inf.");
-      }
+  postProcessOBJ(output.geometry, options);
 
-      else if(c == "mtllib")
-      {
-        parseMTL(tp_utils::pathAppend(tp_utils::directoryName(filePath), joinName(parts)), objMaterials, progress);
-      }
-    }
-  }
-  catch(const std::invalid_argument& e)
+  if(OBJStats* stats=options.stats; stats)
   {
-    return barf(e.what());
-  }
-  catch(const std::out_of_range& e)
-  {
-    return barf(e.what());
+    stats->meshes += output.geometry.size();
+    for(const auto& o : output.geometry)
+      stats->outputVerts += o.verts.size();
   }
 
-  //-- Extract objects and faces -------------------------------------------------------------------
+  outputGeometry.reserve(outputGeometry.size() + output.geometry.size());
+  for(auto& o : output.geometry)
+    outputGeometry.push_back(std::move(o));
+
+  return true;
+}
+
+//##################################################################################################
+bool parseOBJBuffers(const std::string& filePath,
+                     bool reverse,
+                     std::string& exporterVersion,
+                     OBJMeshBuffers& outputBuffers,
+                     std::vector<std::string>& materialLibraries,
+                     tp_utils::Progress* progress,
+                     const ParseOptions& options)
+{
+  if(!outputBuffers.layout.isValid())
   {
-    std::string materialName;
-    std::string objectName;
-    std::string groupName;
-    bool newObject=true;
-    bool newMesh=true;
+    outputBuffers.clear();
 
-    std::map<std::tuple<size_t,size_t,size_t>, int> indexes;
+    std::string msg = "vertex layout attributes don't fit in the stride.";
+    if(options.error)
+      *options.error = msg;
 
-    for(const auto& parts : lines)
+    if(progress)
     {
-      std::string c = parts.front();
+      progress->addError("Parse OBJ error: ");
+      progress->addError(msg);
+    }
+    return false;
+  }
 
-      if(c == "o")
-      {
-        objectName=joinName(parts);
-        newObject = true;
-        newMesh = true;
-      }
+  BufferOutput output(outputBuffers);
+  if(!parseGeometry(filePath, reverse, exporterVersion, output, materialLibraries, progress, options))
+  {
+    outputBuffers.clear();
+    return false;
+  }
 
-      else if(c == "usemtl")
-      {
-        materialName=joinName(parts);
-        newObject = true;
-        newMesh = true;
-      }
-      else if(c == "g")
-      {
-        groupName=joinName(parts);
-        newMesh = true;
-      }
-      else if(c == "s")
-      {
-        groupName=joinName(parts);
-      }
+  output.finish();
 
-      else if(c == "f")
-      {
-        if(parts.size()<4)
-          continue;
-
-        if(newObject)
-        {
-          newObject = false;
-          indexes.clear();
-          auto& o = outputGeometry.emplace_back();
-          o.triangleFan   = triangleFan  ;
-          o.triangleStrip = triangleStrip;
-          o.triangles     = triangles    ;
-
-          if(!objectName.empty())
-          {
-            o.comments.push_back("MESH_NAME");
-            o.comments.push_back(objectName);
-          }
-
-          if(!materialName.empty())
-          {
-            o.comments.push_back("MATERIAL_NAME");
-            o.comments.push_back(materialName);
-          }
-
-          o.material.name = materialName;
-
-          for(const auto& m : objMaterials)
-          {
-            if(m.name == o.material.name)
-            {
-              o.material = m;
-              break;
-            }
-          }
-        }
-
-        auto& o = outputGeometry.back();
-
-        if(newMesh)
-        {
-          newMesh = false;
-          auto& f = o.indexes.emplace_back();
-          f.type = o.triangles;
-        }
-
-        auto& f = o.indexes.back();
-
-        auto parseAddVert = [&](const std::string& part)
-        {
-          size_t vvi=0;
-          size_t vti=0;
-          size_t vni=0;
-
-          try
-          {
-            std::vector<std::string> indexes;
-            tpSplit(indexes, part, '/', TPSplitBehavior::KeepEmptyParts);
-
-            if(indexes.size()>=1)
-              vvi = size_t(std::stoull(indexes.at(0)))-1;
-
-            if(indexes.size()>=2)
-            {
-              if(indexes.at(1).empty())
-                vti = vvi;
-              else
-                vti = size_t(std::stoull(indexes.at(1)))-1;
-            }
-            else
-              vti = vvi;
-
-            if(indexes.size()>=3)
-            {
-              if(indexes.at(2).empty())
-                vni = vvi;
-              else
-                vni = size_t(std::stoull(indexes.at(2)))-1;
-            }
-            else
-              vni = vvi;
-          }
-          catch (const std::invalid_argument&)
-          {
-            return -1;
-          }
-          catch (const std::out_of_range&)
-          {
-            return -1;
-          }
-
-          const auto i = indexes.find({vvi, vti, vni});
-          if(i!=indexes.end())
-            return i->second;
-
-          tp_math_utils::Vertex3D v;
-
-          if(vvi>=objVV.size())
-            return -1;
-
-          v.vert = objVV.at(vvi);
-
-          if(vti<objVT.size())
-            v.texture = objVT.at(vti);
-
-          if(vni<objVN.size())
-            v.normal = objVN.at(vni);
-
-          int index = int(o.verts.size());
-          indexes[{vvi, vti, vni}] = index;
-          o.verts.push_back(v);
-          return index;
-        };
-
-        int a = parseAddVert(parts.at(1));
-        int b = parseAddVert(parts.at(2));
-        int c = parseAddVert(parts.at(3));
-
-        if(a<0 || b<0 || c<0)
-          continue;
-
-        f.indexes.push_back(a);
-        f.indexes.push_back(b);
-        f.indexes.push_back(c);
-
-        // If its a quad we need to add an extra polygon. It looks like faces can contain an
-        // arbitrary number of points but im not sure what the rule is for triangulating them.
-        if(parts.size()>4)
-        {
-          int d = parseAddVert(parts.at(4));
-          if(d<0)
-            continue;
-
-          f.indexes.push_back(c);
-          f.indexes.push_back(d);
-          f.indexes.push_back(a);
-        }
-      }
-    }
+  postProcessOBJ(outputBuffers, options);
+
+  if(OBJStats* stats=options.stats; stats)
+  {
+    stats->meshes += output.objectCount();
+    stats->outputVerts += outputBuffers.vertexCount;
   }
 
   return true;
 }
 
 //##################################################################################################
-bool parseMTL(const std::string& filePath,
-              std::vector<tp_math_utils::Material>& outputMaterials,
-              tp_utils::Progress* progress)
+template<typename Meshes>
+void postProcess(Meshes& meshes, const ParseOptions& options)
 {
-  TP_UNUSED(progress);
+  OBJStats* stats = options.stats;
+  OBJStatsTimer totalTimer(stats?&stats->totalSeconds:nullptr);
 
-  std::vector<std::vector<std::string>> lines = parseLines(filePath);
-  for(const auto& parts : lines)
+  if(options.weld)
   {
-    std::string c = parts.front();
+    OBJStatsTimer timer(stats?&stats->weldSeconds:nullptr);
+    size_t removed = weldVertices(meshes, *options.weld, options.threadCount);
+    if(stats)
+      stats->weldedVerts += removed;
+  }
 
-    if(c == "newmtl")
-    {
-      auto& m = outputMaterials.emplace_back();
-      m.name = joinName(parts);
+  if(options.optimizeVertexOrder)
+  {
+    OBJStatsTimer timer(stats?&stats->optimizeSeconds:nullptr);
+    optimizeVertexOrder(meshes, options.threadCount);
+  }
+}
 
-      if(!m.name.isValid())
-        m.name = "none";
+//##################################################################################################
+void postProcessOBJ(std::vector<tp_math_utils::Geometry3D>& geometry, const ParseOptions& options)
+{
+  postProcess(geometry, options);
+}
+
+//##################################################################################################
+void postProcessOBJ(OBJMeshBuffers& buffers, const ParseOptions& options)
+{
+  postProcess(buffers, options);
+}
+
+//##################################################################################################
+bool parseOBJSections(std::string_view text,
+                      const OBJIndex& index,
+                      const std::vector<size_t>& sections,
+                      int triangleFan,
+                      int triangleStrip,
+                      int triangles,
+                      bool reverse,
+                      std::vector<tp_math_utils::Geometry3D>& outputGeometry,
+                      std::string& error,
+                      size_t threadCount,
+                      OBJStats* stats,
+                      std::pmr::memory_resource* memoryResource)
+{
+  AttributeSpans spans;
+  for(size_t s : sections)
+  {
+    if(s>=index.sections.size())
+    {
+      error = "Section out of range.";
+      return false;
+    }
 
-      continue;
+    const auto& section = index.sections.at(s);
+    if(section.offset>text.size() || section.size>text.size()-section.offset)
+    {
+      error = "The index does not match the file.";
+      return false;
     }
 
-    if(outputMaterials.empty())
-      continue;
+    spans.add(section);
+  }
 
-    auto& m = outputMaterials.back();
+  std::pmr::monotonic_buffer_resource arena(memoryResource?memoryResource:std::pmr::get_default_resource());
 
-    auto openGLMaterial = m.findOrAddOpenGL();
-    auto legacyMaterial = m.findOrAddLegacy();
+  //-- Read the blocks that hold referenced attributes ---------------------------------------------
+  Attributes attributes(&arena);
+  attributes.vv.resize(spans.positions.count);
+  attributes.vt.resize(spans.texCoords.count);
+  attributes.vn.resize(spans.normals.count);
 
-    if(c == "bml")
+  std::vector<size_t> blocks;
+  {
+    std::vector<bool> marked(index.blocks.size(), false);
+    for(size_t s : sections)
     {
-      auto path = tp_utils::pathAppend(tp_utils::directoryName(filePath), joinName(parts));
-      auto externalMaterial = m.findOrAddExternal("blend");
-      externalMaterial->subPath = path;
-      continue;
+      const auto& section = index.sections.at(s);
+      markBlocks(index.blocks, section.positions, &OBJAttributeBlock::positions, marked);
+      markBlocks(index.blocks, section.texCoords, &OBJAttributeBlock::texCoords, marked);
+      markBlocks(index.blocks, section.normals  , &OBJAttributeBlock::normals  , marked);
     }
 
-    auto boolProperty = [&](auto key, bool& value)
+    for(size_t b=0; b<marked.size(); b++)
     {
-      if(c != key)
-        return false;
-
-      if(parts.size() == 2)
-        value = readBool(parts[1]);
-
-      return true;
-    };
+      if(!marked.at(b))
+        continue;
 
-    auto floatProperty = [&](auto key, float& value)
-    {
-      if(c != key)
+      const auto& block = index.blocks.at(b);
+      if(block.offset>text.size() || block.size>text.size()-block.offset)
+      {
+        error = "The index does not match the file.";
         return false;
+      }
 
-      if(parts.size() == 2)
-        value = readFloat(parts[1]);
-
-      return true;
-    };
+      blocks.push_back(b);
+    }
+  }
 
-    auto sssMethodProperty = [&](auto key, tp_math_utils::SSSMethod& value)
+  {
+    // Each block writes to its own part of the attributes.
+    std::vector<std::string> errors(blocks.size());
+    std::vector<OBJStats> blockStats(stats?blocks.size():0);
+    parallelFor(blocks.size(), resolveThreadCount(threadCount), [&](size_t b)
+    {
+      const auto& block = index.blocks.at(blocks.at(b));
+      BlockVisitor visitor(block, spans, attributes);
+      readOBJText(text.substr(block.offset, block.size),
+                  reverse,
+                  visitor,
+                  nullptr,
+                  errors.at(b),
+                  OBJAttributes,
+                  stats?&blockStats.at(b):nullptr);
+    });
+
+    for(const auto& e : errors)
     {
-      if(c != key)
+      if(!e.empty())
+      {
+        error = e;
         return false;
+      }
+    }
 
-      if(parts.size() == 2)
-        value = tp_math_utils::SSSMethod(readInt(parts[1]));
+    if(stats)
+      for(const auto& blockStat : blockStats)
+        stats->add(blockStat);
+  }
 
-      return true;
-    };
+  //-- Build the meshes of the sections ------------------------------------------------------------
+  Geometry3DOutput output(triangleFan, triangleStrip, triangles);
+  GeometryBuilder builder(output, attributes, &arena);
+  SectionVisitor visitor(builder, spans);
 
-    auto ignoreFloatProperty = [&](auto key)
-    {
-      return (c == key);
-    };
+  size_t previous=SIZE_MAX;
+  size_t previousEnd=0;
+  for(size_t s : sections)
+  {
+    const auto& section = index.sections.at(s);
 
-    auto vec3Property = [&](auto key, glm::vec3& value)
+    // Only sections without faces are left out of the index between neighbouring sections, so the
+    // lines between them are read for their names just like a full parse would. Sections that
+    // don't follow on from the last one need the names that the skipped lines set.
+    if(s == previous+1)
     {
-      if(c != key)
-        return false;
+      if(section.offset>previousEnd)
+        if(!readOBJText(text.substr(previousEnd, section.offset-previousEnd), reverse, visitor, nullptr, error, OBJObjects))
+          return false;
+    }
+    else
+      builder.resumeNames(section.object, section.material, section.group);
 
-      if(parts.size() == 4)
-      {
-        value.x = readFloat(parts[1]);
-        value.y = readFloat(parts[2]);
-        value.z = readFloat(parts[3]);
-      }
+    previous = s;
+    previousEnd = section.offset + section.size;
 
-      return true;
-    };
+    OBJAttributeCounts counts = objAttributeCountsAt(index, section.offset);
+    if(!readOBJText(text.substr(section.offset, section.size), reverse, visitor, nullptr, error, OBJFaces | OBJObjects, stats, nullptr, &counts))
+      return false;
+  }
 
-    auto ignoreVec3Property = [&](auto key)
-    {
-      return (c == key);
-    };
+  builder.finish();
 
-    auto mapProperty = [&](auto key, tp_utils::StringID& value)
-    {
-      if(c != key)
-        return false;
+  if(stats)
+  {
+    stats->peakTemporaryBytes = std::max(stats->peakTemporaryBytes, attributes.memoryUsage() + builder.memoryUsage());
+    stats->cornerLookups += builder.cornerLookups;
+    stats->cornerHits += builder.cornerHits;
+    stats->convexPolygons += builder.convexPolygons;
+    stats->concavePolygons += builder.concavePolygons;
+  }
 
-      value = splitTextureOptions(joinName(parts)).file;
-      return true;
-    };
+  outputGeometry.reserve(outputGeometry.size() + output.geometry.size());
+  for(auto& o : output.geometry)
+    outputGeometry.push_back(std::move(o));
 
-    auto ignoreMapProperty = [&](auto key)
-    {
-      return (c == key);
-    };
+  return true;
+}
 
-    if     ( ignoreVec3Property("Ka"                                      )){} // Ambient Color
-    else if(       vec3Property("Kd"      , openGLMaterial->albedo        )){} // Diffuse Color
-    else if( ignoreVec3Property("Ks"                                      )){} // Specular Color
-    else if(ignoreFloatProperty("Ni"                                      )){} // Optical Density
-    else if(      floatProperty("d"       , openGLMaterial->alpha         )){} // Dissolve
-    else if(        mapProperty("map_Kd"  , openGLMaterial->albedoTexture )){} // Diffuse Texture Map
-    else if(  ignoreMapProperty("map_Ks"                                  )){} // Specular Texture Map
-    else if(  ignoreMapProperty("map_Ns"                                  )){} // Specular Hightlight Map
-    else if(        mapProperty("map_d"   , openGLMaterial->alphaTexture  )){} // Alpha Texture Map
-    else if(        mapProperty("map_Bump", openGLMaterial->normalsTexture)){} // Bump Map
-    else if(        mapProperty("map_bump", openGLMaterial->normalsTexture)){} // Bump Map
-    else if(        mapProperty("bump"    , openGLMaterial->normalsTexture)){} // Bump Map
-    else if(        mapProperty("norm"    , openGLMaterial->normalsTexture)){} // Bump Map
-    else if(  ignoreMapProperty("map_ao"                                  )){} // Alpha Texture Map
+//##################################################################################################
+void assignMaterials(const std::vector<std::string>& materialLibraries,
+                     std::vector<tp_math_utils::Geometry3D>& geometry,
+                     tp_utils::Progress* progress,
+                     OBJStats* stats,
+                     MaterialIndex* sharedMaterials)
+{
+  OBJStatsTimer totalTimer(stats?&stats->totalSeconds:nullptr);
 
-    // Ambient Texture Map
-    else if(c == "map_Ka")
-    {
-      if(!openGLMaterial->albedoTexture.isValid())
-        openGLMaterial->albedoTexture = joinName(parts);
-    }
+  if(sharedMaterials)
+  {
+    sharedMaterials->addLibraries(materialLibraries, progress, stats);
+    return;
+  }
 
-    // Specular Exponent
-    else if(c == "Ns")
-    {
-      if(parts.size() != 2)
-        continue;
+  MaterialIndex index;
+  index.addLibraries(materialLibraries, progress, stats);
 
-      //m.specular = readFloat(parts[1]);
-      //m.roughness = std::sqrt(2.0f/(2.0f+float(m.specular)));
-    }
+  OBJStatsTimer timer(stats?&stats->materialSeconds:nullptr);
+  for(auto& o : geometry)
+    if(const auto* m = index.find(o.material.name); m)
+      o.material = *m;
+}
 
-    // Illumination
-    else if(c == "illum")
-    {
-      if(parts.size() != 2)
-        continue;
+//##################################################################################################
+void assignMaterials(const std::vector<std::string>& materialLibraries,
+                     OBJMeshBuffers& buffers,
+                     tp_utils::Progress* progress,
+                     OBJStats* stats,
+                     MaterialIndex* sharedMaterials)
+{
+  OBJStatsTimer totalTimer(stats?&stats->totalSeconds:nullptr);
 
-      //illum = std::stoi(parts[1]);
-    }
-
-    //-- Extended material properties --------------------------------------------------------------
-    else if(    floatProperty("Roughness"                   , openGLMaterial->roughness                   )){}
-    else if(    floatProperty("Metalness"                   , openGLMaterial->metalness                   )){}
-    else if(    floatProperty("Specular"                    , legacyMaterial->specular                    )){}
-    else if(     vec3Property("Emission"                    , legacyMaterial->emission                    )){}
-    else if(    floatProperty("EmissionStrength"            , legacyMaterial->emissionScale               )){}
-    else if(     vec3Property("Subsurface"                  , legacyMaterial->sss                         )){}
-    else if(    floatProperty("SubsurfaceScale"             , legacyMaterial->sssScale                    )){}
-    else if(     vec3Property("SubsurfaceRadius"            , legacyMaterial->sssRadius                   )){}
-    else if(sssMethodProperty("SubsurfaceMethod"            , legacyMaterial->sssMethod                   )){}
-    else if(    floatProperty("NormalStrength"              , legacyMaterial->normalStrength              )){}
-    else if(    floatProperty("Transmission"                , openGLMaterial->transmission                )){}
-    else if(    floatProperty("TransmissionRoughness"       , openGLMaterial->transmissionRoughness       )){}
-    else if(    floatProperty("Sheen"                       , legacyMaterial->sheen                       )){}
-    else if(    floatProperty("SheenTint"                   , legacyMaterial->sheenTint                   )){}
-    else if(    floatProperty("ClearCoat"                   , legacyMaterial->clearCoat                   )){}
-    else if(    floatProperty("ClearCoatRoughness"          , legacyMaterial->clearCoatRoughness          )){}
-    else if(    floatProperty("IOR"                         , legacyMaterial->ior                         )){}
-    else if(    floatProperty("albedoBrightness"            , openGLMaterial->albedoBrightness            )){}
-    else if(    floatProperty("albedoContrast"              , openGLMaterial->albedoContrast              )){}
-    else if(    floatProperty("albedoGamma"                 , openGLMaterial->albedoGamma                 )){}
-    else if(    floatProperty("albedoHue"                   , openGLMaterial->albedoHue                   )){}
-    else if(    floatProperty("albedoSaturation"            , openGLMaterial->albedoSaturation            )){}
-    else if(    floatProperty("albedoValue"                 , openGLMaterial->albedoValue                 )){}
-    else if(    floatProperty("albedoFactor"                , openGLMaterial->albedoFactor                )){}
-    else if(     boolProperty("rayVisibilityCamera"         , legacyMaterial->rayVisibilityCamera         )){}
-    else if(     boolProperty("rayVisibilityDiffuse"        , legacyMaterial->rayVisibilityDiffuse        )){}
-    else if(     boolProperty("rayVisibilityGlossy"         , legacyMaterial->rayVisibilityGlossy         )){}
-    else if(     boolProperty("rayVisibilityTransmission"   , legacyMaterial->rayVisibilityTransmission   )){}
-    else if(     boolProperty("rayVisibilityScatter"        , legacyMaterial->rayVisibilityScatter        )){}
-    else if(     boolProperty("rayVisibilityShadow"         , legacyMaterial->rayVisibilityShadow         )){}
-    else if(     boolProperty("rayVisibilityShadowCatcher"  , openGLMaterial->rayVisibilityShadowCatcher  )){}
-    else if(      mapProperty("map_ClearCoat"               , legacyMaterial->clearCoatTexture            )){}
-    else if(      mapProperty("map_ClearCoatRoughness"      , legacyMaterial->clearCoatRoughnessTexture   )){}
-    else if(      mapProperty("map_Emission"                , legacyMaterial->emissionTexture             )){}
-    else if(      mapProperty("map_Metalness"               , openGLMaterial->metalnessTexture            )){}
-    else if(      mapProperty("map_Roughness"               , openGLMaterial->roughnessTexture            )){}
-    else if(      mapProperty("map_Sheen"                   , legacyMaterial->sheenTexture                )){}
-    else if(      mapProperty("map_SheenTint"               , legacyMaterial->sheenTintTexture            )){}
-    else if(      mapProperty("map_Specular"                , legacyMaterial->specularTexture             )){}
-    else if(      mapProperty("map_Subsurface"              , legacyMaterial->sssTexture                  )){}
-    else if(      mapProperty("map_SubsurfaceScale"         , legacyMaterial->sssScaleTexture             )){}
-    else if(      mapProperty("map_Transmission"            , openGLMaterial->transmissionTexture         )){}
-    else if(      mapProperty("map_TransmissionRoughness"   , openGLMaterial->transmissionRoughnessTexture)){}
+  if(sharedMaterials)
+  {
+    sharedMaterials->addLibraries(materialLibraries, progress, stats);
+    return;
   }
 
-  return true;
+  MaterialIndex index;
+  index.addLibraries(materialLibraries, progress, stats);
+
+  OBJStatsTimer timer(stats?&stats->materialSeconds:nullptr);
+  for(auto& material : buffers.materials)
+    if(const auto* m = index.find(material.name); m)
+      material = *m;
 }
 
 }
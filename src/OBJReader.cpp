@@ -0,0 +1,474 @@
+#include "tp_obj/OBJReader.h"
+#include "tp_obj/Tokenizer.h"
+#include "tp_obj/NumberParsing.h"
+#include "tp_obj/OBJStats.h"
+#include "tp_obj/Compression.h"
+
+#include "tp_utils/FileUtils.h"
+#include "tp_utils/Progress.h"
+
+#include <algorithm>
+#include <memory>
+
+namespace tp_obj
+{
+
+namespace
+{
+
+//##################################################################################################
+enum class LineType
+{
+  Vertex,
+  TexCoord,
+  Normal,
+  MaterialLibrary,
+  Object,
+  Material,
+  Group,
+  Smoothing,
+  Face,
+  Other
+};
+
+//##################################################################################################
+LineType lineType(std::string_view c)
+{
+  if(c == "v"     ) return LineType::Vertex;
+  if(c == "f"     ) return LineType::Face;
+  if(c == "vt"    ) return LineType::TexCoord;
+  if(c == "vn"    ) return LineType::Normal;
+  if(c == "o"     ) return LineType::Object;
+  if(c == "g"     ) return LineType::Group;
+  if(c == "s"     ) return LineType::Smoothing;
+  if(c == "usemtl") return LineType::Material;
+  if(c == "mtllib") return LineType::MaterialLibrary;
+  return LineType::Other;
+}
+
+//##################################################################################################
+int lineContent(LineType type)
+{
+  switch(type)
+  {
+  case LineType::Vertex:
+  case LineType::TexCoord:
+  case LineType::Normal:          return OBJAttributes;
+  case LineType::Face:            return OBJFaces;
+  case LineType::Object:
+  case LineType::Material:
+  case LineType::Group:
+  case LineType::Smoothing:       return OBJObjects;
+  case LineType::MaterialLibrary: return OBJMaterialLibraries;
+  case LineType::Other:           break;
+  }
+  return 0;
+}
+
+//##################################################################################################
+//! Parse a single 1 based or negative index and return it 0 based.
+OBJCornerError parseIndex(std::string_view text, size_t count, size_t& index)
+{
+  if(text.empty())
+    return OBJCornerError::Empty;
+
+  bool negative = text.front()=='-';
+  if(negative || text.front()=='+')
+    text.remove_prefix(1);
+
+  if(text.empty())
+    return OBJCornerError::Syntax;
+
+  if(text.front()<'0' || text.front()>'9')
+    return OBJCornerError::Syntax;
+
+  // Like stoull anything after the digits is ignored, so "12abc" is 12.
+  size_t value=0;
+  for(char c : text)
+  {
+    if(c<'0' || c>'9')
+      break;
+
+    auto digit = size_t(c-'0');
+    if(value > (SIZE_MAX-digit)/10)
+      return OBJCornerError::Syntax;
+
+    value = value*10 + digit;
+  }
+
+  if(value==0)
+    return OBJCornerError::Zero;
+
+  if(!negative)
+  {
+    index = value-1;
+    return OBJCornerError::None;
+  }
+
+  if(value>count)
+    return OBJCornerError::OutOfRange;
+
+  index = count-value;
+  return OBJCornerError::None;
+}
+
+}
+
+//##################################################################################################
+OBJCornerError parseOBJCorner(std::string_view token, const OBJAttributeCounts& counts, OBJCorner& corner)
+{
+  corner = OBJCorner();
+
+  // Split on '/' into views of the token, anything after the third index is ignored.
+  std::string_view indexes[3];
+  size_t count=0;
+  for(;;)
+  {
+    size_t slash = token.find('/');
+    if(count<3)
+      indexes[count] = token.substr(0, slash);
+    count++;
+
+    if(slash == std::string_view::npos)
+      break;
+    token.remove_prefix(slash+1);
+  }
+
+  if(auto e = parseIndex(indexes[0], counts.positions, corner.vvi); e!=OBJCornerError::None)
+    return e;
+
+  // A missing tex coord or normal index uses the position index.
+  corner.vti = corner.vvi;
+  corner.vni = corner.vvi;
+
+  // A tex coord or normal index that is not a number makes the corner invalid, one that is a number
+  // but does not refer to an attribute only loses that attribute and the face is still used.
+  OBJCornerError result = OBJCornerError::None;
+
+  if(count>=2 && !indexes[1].empty())
+  {
+    if(auto e = parseIndex(indexes[1], counts.texCoords, corner.vti); e!=OBJCornerError::None)
+    {
+      if(e==OBJCornerError::Syntax)
+        return e;
+
+      corner.vti = SIZE_MAX;
+      result = e;
+    }
+  }
+
+  if(count>=3 && !indexes[2].empty())
+  {
+    if(auto e = parseIndex(indexes[2], counts.normals, corner.vni); e!=OBJCornerError::None)
+    {
+      if(e==OBJCornerError::Syntax)
+        return e;
+
+      corner.vni = SIZE_MAX;
+      result = e;
+    }
+  }
+
+  corner.valid = true;
+  return result;
+}
+
+//##################################################################################################
+OBJVisitor::~OBJVisitor()=default;
+
+//##################################################################################################
+void OBJVisitor::vertex(const glm::vec3& position)
+{
+  TP_UNUSED(position);
+}
+
+//##################################################################################################
+void OBJVisitor::texCoord(const glm::vec2& texCoord)
+{
+  TP_UNUSED(texCoord);
+}
+
+//##################################################################################################
+void OBJVisitor::normal(const glm::vec3& normal)
+{
+  TP_UNUSED(normal);
+}
+
+//##################################################################################################
+void OBJVisitor::face(const std::vector<OBJCorner>& corners)
+{
+  TP_UNUSED(corners);
+}
+
+//##################################################################################################
+void OBJVisitor::object(const std::string& name)
+{
+  TP_UNUSED(name);
+}
+
+//##################################################################################################
+void OBJVisitor::group(const std::string& name)
+{
+  TP_UNUSED(name);
+}
+
+//##################################################################################################
+void OBJVisitor::smoothingGroup(const std::string& name)
+{
+  TP_UNUSED(name);
+}
+
+//##################################################################################################
+void OBJVisitor::material(const std::string& name)
+{
+  TP_UNUSED(name);
+}
+
+//##################################################################################################
+void OBJVisitor::materialLibrary(const std::string& fileName)
+{
+  TP_UNUSED(fileName);
+}
+
+//##################################################################################################
+bool readOBJText(std::string_view text,
+                 bool reverse,
+                 OBJVisitor& visitor,
+                 std::string* exporterVersion,
+                 std::string& error,
+                 int content,
+                 OBJStats* stats,
+                 tp_utils::Progress* progress,
+                 OBJAttributeCounts* counts)
+{
+  OBJAttributeCounts localCounts;
+  OBJAttributeCounts& attributeCounts = counts?*counts:localCounts;
+
+  auto fail = [&](const char* msg)
+  {
+    error = msg;
+    return false;
+  };
+
+  // Reused for every face, it only grows for faces with more corners than any before them.
+  std::vector<OBJCorner> corners;
+  corners.reserve(8);
+
+  // Split the time since the last lap between the phases.
+  using Clock = std::chrono::steady_clock;
+  Clock::time_point lapStart;
+  auto lap = [&](double& seconds)
+  {
+    auto now = Clock::now();
+    seconds += std::chrono::duration<double>(now - lapStart).count();
+    lapStart = now;
+  };
+
+  if(stats)
+  {
+    stats->bytes += text.size();
+    lapStart = Clock::now();
+  }
+
+  size_t lineCount=0;
+  LineTokenizer tokenizer(text, exporterVersion);
+  while(tokenizer.next())
+  {
+    const auto& parts = tokenizer.parts();
+    LineType type = lineType(parts.front());
+
+    lineCount++;
+    if(progress && (lineCount&0xFFFF)==0)
+    {
+      progress->setProgress(float(tokenizer.position())/float(text.size()));
+      if(progress->shouldStop())
+        return fail("Cancelled.");
+    }
+
+    if(stats)
+      lap(stats->tokenizeSeconds);
+
+    // Attributes are counted even when they are skipped so that negative indexes can be resolved.
+    switch(type)
+    {
+    case LineType::Vertex:   attributeCounts.positions++; break;
+    case LineType::TexCoord: attributeCounts.texCoords++; break;
+    case LineType::Normal:   attributeCounts.normals++;   break;
+    default:                                              break;
+    }
+
+    if(!(lineContent(type) & content))
+      continue;
+
+    switch(type)
+    {
+    case LineType::Vertex:
+    {
+      if(parts.size()<4)
+        return fail("v should have 4 parts.");
+
+      glm::vec3 v;
+
+      if(!parseFloat(parts[1], v.x) || !parseFloat(parts[2], v.y) || !parseFloat(parts[3], v.z))
+        return fail("v should contain numbers.");
+
+      if(glm::any(glm::isnan(v)))
+        return fail("v NaN.");
+
+      if(glm::any(glm::isinf(v)))
+        return fail("v inf.");
+
+      visitor.vertex(v);
+      break;
+    }
+
+    case LineType::TexCoord:
+    {
+      if(parts.size()<3)
+        return fail("vt should have 3 parts.");
+
+      glm::vec2 v;
+
+      if(!parseFloat(parts[1], v.x) || !parseFloat(parts[2], v.y))
+        return fail("vt should contain numbers.");
+
+      if(glm::any(glm::isnan(v)))
+        return fail("v NaN.");
+
+      if(glm::any(glm::isinf(v)))
+        return fail("v inf.");
+
+      if(reverse)
+        v.y = 1.0f-v.y;
+
+      visitor.texCoord(v);
+      break;
+    }
+
+    case LineType::Normal:
+    {
+      if(parts.size()<4)
+        return fail("vn should have 4 parts.");
+
+      glm::vec3 v;
+
+      if(!parseFloat(parts[1], v.x) || !parseFloat(parts[2], v.y) || !parseFloat(parts[3], v.z))
+        return fail("vn should contain numbers.");
+
+      if(glm::any(glm::isnan(v)))
+        return fail("v NaN.");
+
+      if(glm::any(glm::isinf(v)))
+        return fail("v inf.");
+
+      visitor.normal(v);
+      break;
+    }
+
+    case LineType::Face:
+    {
+      corners.clear();
+      for(size_t i=1; i<parts.size(); i++)
+        if(parseOBJCorner(parts.at(i), attributeCounts, corners.emplace_back())!=OBJCornerError::None && stats)
+          stats->invalidCorners++;
+      visitor.face(corners);
+      break;
+    }
+
+    case LineType::Object:          visitor.object(joinName(parts));          break;
+    case LineType::Group:           visitor.group(joinName(parts));           break;
+    case LineType::Smoothing:       visitor.smoothingGroup(joinName(parts));  break;
+    case LineType::Material:        visitor.material(joinName(parts));        break;
+    case LineType::MaterialLibrary: visitor.materialLibrary(joinName(parts)); break;
+    case LineType::Other:                                                     break;
+    }
+
+    if(stats)
+    {
+      switch(type)
+      {
+      case LineType::Vertex:   stats->positions++; lap(stats->attributeSeconds); break;
+      case LineType::TexCoord: stats->texCoords++; lap(stats->attributeSeconds); break;
+      case LineType::Normal:   stats->normals++;   lap(stats->attributeSeconds); break;
+      case LineType::Face:     stats->faces++;     lap(stats->faceSeconds);      break;
+      default:                                     lap(stats->faceSeconds);      break;
+      }
+    }
+  }
+
+  if(stats)
+    stats->lines += lineCount;
+
+  return true;
+}
+
+//##################################################################################################
+bool readOBJData(std::string_view data,
+                 bool reverse,
+                 OBJVisitor& visitor,
+                 std::string* exporterVersion,
+                 std::string& error,
+                 int content,
+                 OBJStats* stats,
+                 tp_utils::Progress* progress)
+{
+  if(detectCompression(data) == Compression::None)
+    return readOBJText(data, reverse, visitor, exporterVersion, error, content, stats, progress);
+
+  OBJAttributeCounts counts;
+  return forEachTextBlock(data, [&](std::string_view text, float fraction)
+  {
+    if(!readOBJText(text, reverse, visitor, exporterVersion, error, content, stats, nullptr, &counts))
+      return false;
+
+    if(progress)
+    {
+      progress->setProgress(fraction);
+      if(progress->shouldStop())
+      {
+        error = "Cancelled.";
+        return false;
+      }
+    }
+
+    return true;
+  }, error);
+}
+
+//##################################################################################################
+bool readOBJ(const std::string& filePath,
+             bool reverse,
+             OBJVisitor& visitor,
+             std::string& exporterVersion,
+             tp_utils::Progress* progress,
+             OBJStats* stats)
+{
+  OBJStatsTimer totalTimer(stats?&stats->totalSeconds:nullptr);
+
+  auto barf = [&](const std::string& msg)
+  {
+    if(progress)
+    {
+      progress->addError("Parse OBJ error: ");
+      progress->addError(msg);
+    }
+    return false;
+  };
+
+  if(!tp_utils::exists(filePath))
+    return barf("file doesn't exist: " + filePath);
+
+  std::unique_ptr<MappedFile> file;
+  {
+    OBJStatsTimer ioTimer(stats?&stats->ioSeconds:nullptr);
+    file = std::make_unique<MappedFile>(filePath);
+  }
+
+  std::string error;
+  if(!readOBJData(file->text(), reverse, visitor, &exporterVersion, error, OBJAll, stats, progress))
+    return barf(error);
+
+  return true;
+}
+
+}
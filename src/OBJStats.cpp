@@ -0,0 +1,41 @@
+#include "tp_obj/OBJStats.h"
+
+#include <algorithm>
+
+namespace tp_obj
+{
+
+//##################################################################################################
+void OBJStats::add(const OBJStats& other)
+{
+  totalSeconds     += other.totalSeconds;
+  ioSeconds        += other.ioSeconds;
+  tokenizeSeconds  += other.tokenizeSeconds;
+  attributeSeconds += other.attributeSeconds;
+  faceSeconds      += other.faceSeconds;
+  materialSeconds  += other.materialSeconds;
+  serializeSeconds += other.serializeSeconds;
+  weldSeconds      += other.weldSeconds;
+  optimizeSeconds  += other.optimizeSeconds;
+
+  bytes           += other.bytes;
+  lines           += other.lines;
+  positions       += other.positions;
+  texCoords       += other.texCoords;
+  normals         += other.normals;
+  faces           += other.faces;
+  meshes          += other.meshes;
+  materials       += other.materials;
+  mtlCacheHits    += other.mtlCacheHits;
+  invalidCorners  += other.invalidCorners;
+  cornerLookups   += other.cornerLookups;
+  cornerHits      += other.cornerHits;
+  convexPolygons  += other.convexPolygons;
+  concavePolygons += other.concavePolygons;
+  weldedVerts     += other.weldedVerts;
+  outputVerts     += other.outputVerts;
+
+  peakTemporaryBytes = std::max(peakTemporaryBytes, other.peakTemporaryBytes);
+}
+
+}
@@ -0,0 +1,249 @@
+#include "tp_obj/OutputBuffer.h"
+
+#include <charconv>
+#include <cstring>
+#include <algorithm>
+
+#if !defined(__cpp_lib_to_chars)
+#  include <cstdio>
+#endif
+
+#if defined(_WIN32)
+#  ifndef NOMINMAX
+#    define NOMINMAX
+#  endif
+#  include <windows.h>
+#  include <io.h>
+#  include <fcntl.h>
+#  include <sys/stat.h>
+#else
+#  include <fcntl.h>
+#  include <unistd.h>
+#  include <cerrno>
+#endif
+
+namespace tp_obj
+{
+
+namespace
+{
+//##################################################################################################
+// The longest fixed notation float is 39 digits, a sign, a point and the digits after the point.
+constexpr int maxPrecision = 32;
+constexpr size_t maxFloatChars = 80;
+}
+
+//##################################################################################################
+OutputBuffer::OutputBuffer(const Sink& sink, size_t capacity):
+  m_sink(sink),
+  m_data(new char[std::max(capacity, maxFloatChars)]),
+  m_capacity(std::max(capacity, maxFloatChars))
+{
+
+}
+
+//##################################################################################################
+OutputBuffer::~OutputBuffer()
+{
+  flush();
+  delete[] m_data;
+}
+
+//##################################################################################################
+void OutputBuffer::append(std::string_view text)
+{
+  if(text.size()<=m_capacity-m_size)
+  {
+    std::memcpy(m_data+m_size, text.data(), text.size());
+    m_size += text.size();
+    return;
+  }
+
+  flush();
+
+  if(text.size()<m_capacity)
+  {
+    std::memcpy(m_data, text.data(), text.size());
+    m_size = text.size();
+    return;
+  }
+
+  // Too big to buffer so pass it straight through.
+  if(m_ok)
+    m_ok = m_sink(text.data(), text.size());
+  m_flushed += text.size();
+}
+
+//##################################################################################################
+void OutputBuffer::appendInt(int64_t value)
+{
+  reserve(24);
+#if defined(__cpp_lib_to_chars)
+  m_size = size_t(std::to_chars(m_data+m_size, m_data+m_capacity, value).ptr - m_data);
+#else
+  m_size += size_t(std::snprintf(m_data+m_size, 24, "%lld", (long long)value));
+#endif
+}
+
+//##################################################################################################
+void OutputBuffer::appendFloat(float value, int precision)
+{
+  reserve(maxFloatChars);
+  char* first = m_data+m_size;
+  char* last = m_data+m_capacity;
+
+#if defined(__cpp_lib_to_chars)
+  std::to_chars_result result;
+  if(precision<0)
+    result = std::to_chars(first, last, value);
+  else
+    result = std::to_chars(first, last, value, std::chars_format::fixed, std::min(precision, maxPrecision));
+  m_size = size_t(result.ptr - m_data);
+#else
+  int n = (precision<0)?
+        std::snprintf(first, size_t(last-first), "%.9g", double(value)):
+        std::snprintf(first, size_t(last-first), "%.*f", std::min(precision, maxPrecision), double(value));
+  m_size += size_t(std::max(n, 0));
+#endif
+}
+
+//##################################################################################################
+bool OutputBuffer::flush()
+{
+  if(m_size>0)
+  {
+    if(m_ok)
+      m_ok = m_sink(m_data, m_size);
+    m_flushed += m_size;
+    m_size = 0;
+  }
+
+  return m_ok;
+}
+
+//##################################################################################################
+struct OutputFile::Private
+{
+  int fd{-1};
+};
+
+//##################################################################################################
+OutputFile::OutputFile(const std::string& filePath):
+  d(new Private())
+{
+#if defined(_WIN32)
+  d->fd = _open(filePath.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+  d->fd = ::open(filePath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+#endif
+}
+
+//##################################################################################################
+OutputFile::~OutputFile()
+{
+  close();
+  delete d;
+}
+
+//##################################################################################################
+bool OutputFile::isValid() const
+{
+  return d->fd>=0;
+}
+
+//##################################################################################################
+bool OutputFile::write(const char* data, size_t size)
+{
+  if(d->fd<0)
+    return false;
+
+  while(size>0)
+  {
+#if defined(_WIN32)
+    int n = _write(d->fd, data, unsigned(std::min(size, size_t(1)<<30)));
+    if(n<=0)
+      return false;
+#else
+    ssize_t n = ::write(d->fd, data, size);
+    if(n<0 && errno==EINTR)
+      continue;
+    if(n<=0)
+      return false;
+#endif
+    data += n;
+    size -= size_t(n);
+  }
+
+  return true;
+}
+
+//##################################################################################################
+bool OutputFile::writeAt(size_t position, const char* data, size_t size)
+{
+  if(d->fd<0)
+    return false;
+
+  while(size>0)
+  {
+#if defined(_WIN32)
+    OVERLAPPED overlapped{};
+    overlapped.Offset = DWORD(uint64_t(position) & 0xFFFFFFFFu);
+    overlapped.OffsetHigh = DWORD(uint64_t(position) >> 32);
+
+    DWORD n=0;
+    HANDLE handle = HANDLE(_get_osfhandle(d->fd));
+    if(!WriteFile(handle, data, DWORD(std::min(size, size_t(1)<<30)), &n, &overlapped) || n==0)
+      return false;
+#else
+    ssize_t n = ::pwrite(d->fd, data, size, off_t(position));
+    if(n<0 && errno==EINTR)
+      continue;
+    if(n<=0)
+      return false;
+#endif
+    data += n;
+    size -= size_t(n);
+    position += size_t(n);
+  }
+
+  return true;
+}
+
+//##################################################################################################
+bool OutputFile::resize(size_t size)
+{
+  if(d->fd<0)
+    return false;
+
+#if defined(_WIN32)
+  return _chsize_s(d->fd, __int64(size))==0;
+#else
+  return ::ftruncate(d->fd, off_t(size))==0;
+#endif
+}
+
+//##################################################################################################
+bool OutputFile::close()
+{
+  if(d->fd<0)
+    return false;
+
+#if defined(_WIN32)
+  bool ok = _close(d->fd)==0;
+#else
+  bool ok = ::close(d->fd)==0;
+#endif
+  d->fd = -1;
+  return ok;
+}
+
+//##################################################################################################
+OutputBuffer::Sink OutputFile::sink()
+{
+  return [this](const char* data, size_t size)
+  {
+    return write(data, size);
+  };
+}
+
+}
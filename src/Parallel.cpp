@@ -0,0 +1,183 @@
+#include "tp_obj/Parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+namespace tp_obj
+{
+
+namespace
+{
+
+//##################################################################################################
+//! A call to parallelFor that the threads of the pool can help with.
+struct Job
+{
+  size_t count{0};
+  const std::function<void(size_t)>* closure{nullptr};
+  std::atomic<size_t> next{0};
+  size_t tickets{0};  //!< Pool threads that may still join in, guarded by the pool mutex.
+  size_t running{0};  //!< Pool threads working on the job, guarded by the pool mutex.
+
+  std::mutex exceptionMutex;
+  std::exception_ptr exception; //!< The first exception thrown by the closure.
+
+  //################################################################################################
+  //! Work through the indexes, an exception stops every thread taking more and is kept for later.
+  void run()
+  {
+    try
+    {
+      for(size_t i=next++; i<count; i=next++)
+        (*closure)(i);
+    }
+    catch(...)
+    {
+      next = count;
+
+      std::lock_guard<std::mutex> lock(exceptionMutex);
+      if(!exception)
+        exception = std::current_exception();
+    }
+  }
+};
+
+//##################################################################################################
+//! Threads that are kept between calls to parallelFor.
+/*!
+The pool grows to the largest number of helpers that has been asked for. The thread that calls run
+always works on its own job, so a job finishes even if every pool thread is busy, and calls from
+inside a closure don't deadlock.
+*/
+class ThreadPool
+{
+public:
+  //################################################################################################
+  ~ThreadPool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stop = true;
+    }
+    m_wake.notify_all();
+
+    for(auto& thread : m_threads)
+      thread.join();
+  }
+
+  //################################################################################################
+  void run(Job& job, size_t helpers)
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      while(m_threads.size()<helpers)
+        m_threads.emplace_back([this]{work();});
+
+      job.tickets = helpers;
+      m_jobs.push_back(&job);
+    }
+
+    for(size_t h=0; h<helpers; h++)
+      m_wake.notify_one();
+
+    job.run();
+    finish(job);
+
+    // Pass on the first exception from any of the threads once none of them are using the job.
+    if(job.exception)
+      std::rethrow_exception(job.exception);
+  }
+
+private:
+  //################################################################################################
+  //! Every index has been handed out, so threads that have not joined in yet are not needed.
+  void finish(Job& job)
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if(job.tickets>0)
+    {
+      job.tickets = 0;
+      m_jobs.erase(std::find(m_jobs.begin(), m_jobs.end(), &job));
+    }
+
+    m_done.wait(lock, [&]{return job.running==0;});
+  }
+
+  //################################################################################################
+  void work()
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for(;;)
+    {
+      m_wake.wait(lock, [&]{return m_stop || !m_jobs.empty();});
+      if(m_stop)
+        return;
+
+      Job* job = m_jobs.front();
+      job->tickets--;
+      if(job->tickets==0)
+        m_jobs.pop_front();
+      job->running++;
+
+      lock.unlock();
+      job->run();
+      lock.lock();
+
+      job->running--;
+      if(job->running==0)
+        m_done.notify_all();
+    }
+  }
+
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  std::condition_variable m_done;
+  std::deque<Job*> m_jobs;
+  std::vector<std::thread> m_threads;
+  bool m_stop{false};
+};
+
+//##################################################################################################
+ThreadPool& threadPool()
+{
+  static ThreadPool threadPool;
+  return threadPool;
+}
+
+}
+
+//##################################################################################################
+size_t resolveThreadCount(size_t threadCount)
+{
+  if(threadCount == 0)
+    threadCount = size_t(std::thread::hardware_concurrency());
+
+  return std::max(size_t(1), threadCount);
+}
+
+//##################################################################################################
+void parallelFor(size_t count,
+                 size_t threadCount,
+                 const std::function<void(size_t)>& closure)
+{
+  threadCount = std::min(resolveThreadCount(threadCount), count);
+
+  if(threadCount<=1)
+  {
+    for(size_t i=0; i<count; i++)
+      closure(i);
+    return;
+  }
+
+  Job job;
+  job.count = count;
+  job.closure = &closure;
+  threadPool().run(job, threadCount-1);
+}
+
+}
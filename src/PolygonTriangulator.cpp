@@ -0,0 +1,212 @@
+#include "tp_obj/PolygonTriangulator.h"
+
+namespace tp_obj
+{
+
+namespace
+{
+
+//##################################################################################################
+float cross(const glm::vec2& a, const glm::vec2& b, const glm::vec2& c)
+{
+  return (b.x-a.x)*(c.y-b.y) - (b.y-a.y)*(c.x-b.x);
+}
+
+//##################################################################################################
+int sign(float value)
+{
+  return (value>0.0f)?1:((value<0.0f)?-1:0);
+}
+
+//##################################################################################################
+//! Points on the edge of the triangle count as inside, a point on the edge would make a bad ear.
+bool insideTriangle(const glm::vec2& p, const glm::vec2& a, const glm::vec2& b, const glm::vec2& c, int orientation)
+{
+  return float(orientation)*cross(a, b, p)>=0.0f &&
+         float(orientation)*cross(b, c, p)>=0.0f &&
+         float(orientation)*cross(c, a, p)>=0.0f;
+}
+
+}
+
+//##################################################################################################
+PolygonTriangulator::PolygonTriangulator(std::pmr::memory_resource* resource):
+  m_points(resource),
+  m_remaining(resource),
+  m_triangles(resource)
+{
+
+}
+
+//##################################################################################################
+bool PolygonTriangulator::triangulate(const glm::vec3* points, size_t count)
+{
+  m_triangles.clear();
+  if(count<3)
+    return true;
+
+  // Newell's method gives a normal that works for concave and slightly non planar polygons.
+  glm::vec3 normal{0.0f, 0.0f, 0.0f};
+  for(size_t i=0; i<count; i++)
+  {
+    const glm::vec3& a = points[i];
+    const glm::vec3& b = points[(i+1)%count];
+    normal.x += (a.y-b.y)*(a.z+b.z);
+    normal.y += (a.z-b.z)*(a.x+b.x);
+    normal.z += (a.x-b.x)*(a.y+b.y);
+  }
+
+  // Drop the largest component of the normal, the axes are ordered so the polygon keeps its winding
+  // when the normal points along the positive axis.
+  glm::vec3 n = glm::abs(normal);
+  int axis = (n.x>n.y && n.x>n.z)?0:((n.y>n.z)?1:2);
+
+  m_points.clear();
+  for(size_t i=0; i<count; i++)
+  {
+    const glm::vec3& p = points[i];
+    if(axis==0)
+      m_points.emplace_back(p.y, p.z);
+    else if(axis==1)
+      m_points.emplace_back(p.z, p.x);
+    else
+      m_points.emplace_back(p.x, p.y);
+  }
+
+  int orientation = sign(normal[axis]);
+
+  m_remaining.clear();
+  for(size_t i=0; i<count; i++)
+    m_remaining.push_back(i);
+
+  if(orientation==0 || isConvex(orientation))
+  {
+    addFan(m_remaining.data(), count);
+    return true;
+  }
+
+  clipEars(orientation);
+  return false;
+}
+
+//##################################################################################################
+bool PolygonTriangulator::isConvex(int orientation) const
+{
+  // Every corner must turn the same way and the edges can only change direction along x twice,
+  // otherwise the polygon wraps around more than once like a star.
+  size_t count = m_points.size();
+  int directionChanges=0;
+  int lastDirection=0;
+  for(size_t i=0; i<count; i++)
+  {
+    const glm::vec2& a = m_points[i];
+    const glm::vec2& b = m_points[(i+1)%count];
+    const glm::vec2& c = m_points[(i+2)%count];
+
+    if(float(orientation)*cross(a, b, c)<0.0f)
+      return false;
+
+    if(int direction=sign(b.x-a.x); direction!=0)
+    {
+      if(lastDirection!=0 && direction!=lastDirection)
+        directionChanges++;
+      lastDirection = direction;
+    }
+  }
+
+  // The loop does not compare the last edge with the first.
+  for(size_t i=0; i<count; i++)
+  {
+    if(int direction=sign(m_points[(i+1)%count].x-m_points[i].x); direction!=0)
+    {
+      if(direction!=lastDirection)
+        directionChanges++;
+      break;
+    }
+  }
+
+  return directionChanges<=2;
+}
+
+//##################################################################################################
+void PolygonTriangulator::clipEars(int orientation)
+{
+  // Start looking for the next ear where the last one was found, most polygons are then clipped in a
+  // single pass around the outline.
+  size_t k=0;
+  size_t tried=0;
+  while(m_remaining.size()>3)
+  {
+    size_t count = m_remaining.size();
+    if(tried>=count)
+    {
+      // No ears left, the polygon crosses itself so fan what remains.
+      addFan(m_remaining.data(), count);
+      return;
+    }
+
+    k %= count;
+    size_t a = m_remaining[(k+count-1)%count];
+    size_t b = m_remaining[k];
+    size_t c = m_remaining[(k+1)%count];
+
+    float turn = float(orientation)*cross(m_points[a], m_points[b], m_points[c]);
+
+    // Corners with no area are dropped without adding a triangle.
+    bool ear = (turn==0.0f);
+    if(turn>0.0f)
+    {
+      ear = true;
+      for(size_t i : m_remaining)
+      {
+        if(i==a || i==b || i==c)
+          continue;
+
+        const glm::vec2& p = m_points[i];
+        if(p==m_points[a] || p==m_points[b] || p==m_points[c])
+          continue;
+
+        if(insideTriangle(p, m_points[a], m_points[b], m_points[c], orientation))
+        {
+          ear = false;
+          break;
+        }
+      }
+
+      if(ear)
+      {
+        m_triangles.push_back(a);
+        m_triangles.push_back(b);
+        m_triangles.push_back(c);
+      }
+    }
+
+    if(ear)
+    {
+      m_remaining.erase(m_remaining.begin()+std::ptrdiff_t(k));
+      tried = 0;
+      if(k>0)
+        k--;
+    }
+    else
+    {
+      k++;
+      tried++;
+    }
+  }
+
+  addFan(m_remaining.data(), m_remaining.size());
+}
+
+//##################################################################################################
+void PolygonTriangulator::addFan(const size_t* polygon, size_t count)
+{
+  for(size_t i=2; i<count; i++)
+  {
+    m_triangles.push_back(polygon[0]);
+    m_triangles.push_back(polygon[i-1]);
+    m_triangles.push_back(polygon[i]);
+  }
+}
+
+}
@@ -1,8 +1,26 @@
 #include "tp_obj/ReadOBJ.h"
 #include "tp_obj/OBJParser.h"
+#include "tp_obj/OBJCache.h"
+#include "tp_obj/OBJIndex.h"
+#include "tp_obj/Tokenizer.h"
+#include "tp_obj/Compression.h"
+#include "tp_obj/OBJStats.h"
+#include "tp_obj/MaterialPrefetch.h"
+#include "tp_obj/MaterialIndex.h"
+#include "tp_obj/Parallel.h"
+#include "tp_obj/VertexWeld.h"
+
+#include "tp_utils/FileUtils.h"
+#include "tp_utils/Progress.h"
 
 #include "tp_math_utils/Geometry3D.h"
 
+#include <algorithm>
+#include <exception>
+#include <filesystem>
+#include <mutex>
+#include <unordered_set>
+
 namespace tp_obj
 {
 
@@ -14,16 +32,363 @@ bool readOBJFile(const std::string & filePath,
                  bool reverse,
                  std::string& exporterVersion,
                  std::vector<tp_math_utils::Geometry3D>& outputGeometry,
-                 tp_utils::Progress* progress)
+                 tp_utils::Progress* progress,
+                 const ParseOptions& options)
 {
-  return parseOBJ(filePath,
-                  triangleFan,
-                  triangleStrip,
-                  triangles,
-                  reverse,
-                  exporterVersion,
-                  outputGeometry,
-                  progress);
+  if(!options.useCache)
+    return parseOBJ(filePath,
+                    triangleFan,
+                    triangleStrip,
+                    triangles,
+                    reverse,
+                    exporterVersion,
+                    outputGeometry,
+                    progress,
+                    options);
+
+  OBJCacheParameters parameters;
+  parameters.triangleFan   = triangleFan  ;
+  parameters.triangleStrip = triangleStrip;
+  parameters.triangles     = triangles    ;
+  parameters.reverse       = reverse      ;
+  parameters.optimizeVertexOrder = options.optimizeVertexOrder;
+  if(options.weld)
+  {
+    parameters.weld         = true;
+    parameters.weldPosition = options.weld->position;
+    parameters.weldTexCoord = options.weld->texCoord;
+    parameters.weldNormal   = options.weld->normal;
+  }
+
+  std::string cachePath = objCachePath(filePath, options.cacheDirectory);
+  std::vector<tp_math_utils::Geometry3D> geometry;
+  std::vector<std::string> materialLibraries;
+
+  OBJStats* stats = options.stats;
+
+  bool loaded=false;
+  {
+    OBJStatsTimer totalTimer(stats?&stats->totalSeconds:nullptr);
+    OBJStatsTimer ioTimer(stats?&stats->ioSeconds:nullptr);
+    loaded = loadOBJCache(cachePath, filePath, parameters, exporterVersion, geometry, materialLibraries);
+  }
+
+  if(loaded)
+  {
+    if(stats)
+    {
+      stats->meshes += geometry.size();
+      for(const auto& o : geometry)
+        stats->outputVerts += o.verts.size();
+    }
+  }
+  else
+  {
+    // Stamp the file before it is read so that changes made during the parse invalidate the cache.
+    FileStamp stamp = fileStamp(filePath);
+
+    MaterialPrefetch prefetch(filePath, options.prefetchMaterials);
+
+    std::string version;
+    if(!parseOBJGeometry(filePath,
+                         triangleFan,
+                         triangleStrip,
+                         triangles,
+                         reverse,
+                         version,
+                         geometry,
+                         materialLibraries,
+                         progress,
+                         options))
+      return false;
+
+    {
+      OBJStatsTimer totalTimer(stats?&stats->totalSeconds:nullptr);
+      OBJStatsTimer ioTimer(stats?&stats->ioSeconds:nullptr);
+      saveOBJCache(cachePath, filePath, stamp, parameters, version, geometry, materialLibraries);
+    }
+
+    if(!version.empty())
+      exporterVersion = version;
+
+    prefetch.join(stats);
+  }
+
+  assignMaterials(materialLibraries, geometry, progress, stats, options.sharedMaterials);
+
+  outputGeometry.reserve(outputGeometry.size() + geometry.size());
+  for(auto& o : geometry)
+    outputGeometry.push_back(std::move(o));
+
+  return true;
+}
+
+//##################################################################################################
+bool readOBJFile(const std::string& filePath,
+                 bool reverse,
+                 std::string& exporterVersion,
+                 OBJMeshBuffers& outputBuffers,
+                 tp_utils::Progress* progress,
+                 const ParseOptions& options)
+{
+  MaterialPrefetch prefetch(filePath, options.prefetchMaterials);
+
+  std::vector<std::string> materialLibraries;
+  if(!parseOBJBuffers(filePath, reverse, exporterVersion, outputBuffers, materialLibraries, progress, options))
+    return false;
+
+  prefetch.join(options.stats);
+  assignMaterials(materialLibraries, outputBuffers, progress, options.stats, options.sharedMaterials);
+  return true;
+}
+
+//##################################################################################################
+OBJSectionFilter objNameFilter(const std::vector<std::string>& names)
+{
+  auto set = std::make_shared<std::unordered_set<std::string>>(names.begin(), names.end());
+  return [set](const OBJSection& section)
+  {
+    return set->count(section.object)>0 || set->count(section.group)>0;
+  };
+}
+
+//##################################################################################################
+bool readOBJSections(const std::string& filePath,
+                     int triangleFan,
+                     int triangleStrip,
+                     int triangles,
+                     bool reverse,
+                     const OBJSectionFilter& filter,
+                     std::string& exporterVersion,
+                     std::vector<tp_math_utils::Geometry3D>& outputGeometry,
+                     tp_utils::Progress* progress,
+                     const ParseOptions& options)
+{
+  OBJStats* stats = options.stats;
+
+  auto barf = [&](const std::string& msg)
+  {
+    if(options.error)
+      *options.error = msg;
+
+    if(progress)
+    {
+      progress->addError("Parse OBJ error: ");
+      progress->addError(msg);
+    }
+    return false;
+  };
+
+  if(!tp_utils::exists(filePath))
+    return barf("file doesn't exist: " + filePath);
+
+  MaterialPrefetch prefetch(filePath, options.prefetchMaterials);
+
+  std::vector<tp_math_utils::Geometry3D> geometry;
+  OBJIndex index;
+  {
+    OBJStatsTimer totalTimer(stats?&stats->totalSeconds:nullptr);
+
+    // Stamp the file before it is read so that changes made while it is indexed invalidate the index.
+    FileStamp stamp = fileStamp(filePath);
+
+    std::unique_ptr<MappedFile> file;
+    {
+      OBJStatsTimer ioTimer(stats?&stats->ioSeconds:nullptr);
+      file = std::make_unique<MappedFile>(filePath);
+    }
+
+    std::string_view text = file->text();
+    std::string decompressed;
+    std::string error;
+
+    bool compressed = detectCompression(text)!=Compression::None;
+    if(compressed)
+    {
+      if(!forEachTextBlock(text, [&](std::string_view block, float)
+      {
+        decompressed += block;
+        return true;
+      }, error))
+        return barf(error);
+
+      text = decompressed;
+    }
+
+    bool keepIndex = options.useCache && !compressed;
+    std::string indexPath = objIndexPath(filePath, options.cacheDirectory);
+    if(!keepIndex || !loadOBJIndex(indexPath, filePath, index))
+    {
+      OBJStatsTimer timer(stats?&stats->tokenizeSeconds:nullptr);
+      buildOBJIndex(text, index);
+
+      if(keepIndex)
+        saveOBJIndex(indexPath, filePath, stamp, index);
+    }
+
+    if(progress)
+    {
+      progress->setProgress(0.2f);
+      if(progress->shouldStop())
+        return barf("Cancelled.");
+    }
+
+    std::vector<size_t> sections;
+    for(size_t s=0; s<index.sections.size(); s++)
+      if(filter(index.sections.at(s)))
+        sections.push_back(s);
+
+    if(!parseOBJSections(text,
+                         index,
+                         sections,
+                         triangleFan,
+                         triangleStrip,
+                         triangles,
+                         reverse,
+                         geometry,
+                         error,
+                         options.threadCount,
+                         stats,
+                         options.memoryResource))
+      return barf(error);
+  }
+
+  // This times itself so it is kept out of the scope of totalTimer.
+  postProcessOBJ(geometry, options);
+
+  if(stats)
+  {
+    stats->meshes += geometry.size();
+    for(const auto& o : geometry)
+      stats->outputVerts += o.verts.size();
+  }
+
+  if(!index.exporterVersion.empty())
+    exporterVersion = index.exporterVersion;
+
+  std::vector<std::string> materialLibraries;
+  for(const auto& library : index.materialLibraries)
+    materialLibraries.push_back(tp_utils::pathAppend(tp_utils::directoryName(filePath), library));
+
+  prefetch.join(stats);
+  assignMaterials(materialLibraries, geometry, progress, stats, options.sharedMaterials);
+
+  outputGeometry.reserve(outputGeometry.size() + geometry.size());
+  for(auto& o : geometry)
+    outputGeometry.push_back(std::move(o));
+
+  return true;
+}
+
+//##################################################################################################
+std::vector<OBJBatchResult> readOBJFiles(const std::vector<std::string>& filePaths,
+                                         int triangleFan,
+                                         int triangleStrip,
+                                         int triangles,
+                                         bool reverse,
+                                         tp_utils::Progress* progress,
+                                         const ParseOptions& options)
+{
+  std::vector<OBJBatchResult> results(filePaths.size());
+
+  // Start the largest files first so the small ones fill in the gaps at the end.
+  std::vector<std::pair<uintmax_t, size_t>> order;
+  order.reserve(filePaths.size());
+  for(size_t i=0; i<filePaths.size(); i++)
+  {
+    std::error_code ec;
+    auto size = std::filesystem::file_size(filePaths.at(i), ec);
+    order.emplace_back(ec?0:size, i);
+  }
+  std::stable_sort(order.begin(), order.end(), [](const auto& a, const auto& b)
+  {
+    return a.first>b.first;
+  });
+
+  std::mutex mutex;
+  size_t done=0;
+  bool stop=false;
+
+  parallelFor(order.size(), options.threadCount, [&](size_t o)
+  {
+    size_t i = order.at(o).second;
+    auto& result = results.at(i);
+    result.filePath = filePaths.at(i);
+
+    bool cancelled=false;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stop = stop || (progress && progress->shouldStop());
+      cancelled = stop;
+    }
+
+    if(cancelled)
+    {
+      result.error = "Cancelled.";
+      return;
+    }
+
+    MaterialIndex sharedMaterials;
+
+    ParseOptions fileOptions = options;
+    fileOptions.threadCount = 1;
+    fileOptions.stats = options.stats?&result.stats:nullptr;
+    fileOptions.sharedMaterials = options.sharedMaterials?&sharedMaterials:nullptr;
+    fileOptions.error = &result.error;
+
+    // A file that throws only fails itself, the rest of the batch carries on.
+    try
+    {
+      result.ok = readOBJFile(result.filePath,
+                              triangleFan,
+                              triangleStrip,
+                              triangles,
+                              reverse,
+                              result.exporterVersion,
+                              result.geometry,
+                              nullptr,
+                              fileOptions);
+    }
+    catch(const std::exception& e)
+    {
+      result.ok = false;
+      result.error = e.what();
+    }
+    catch(...)
+    {
+      result.ok = false;
+      result.error.clear();
+    }
+
+    if(!result.ok)
+      result.geometry.clear();
+
+    if(!result.ok && result.error.empty())
+      result.error = "Failed to read: " + result.filePath;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    done++;
+
+    if(options.sharedMaterials)
+      options.sharedMaterials->merge(sharedMaterials);
+
+    if(progress)
+    {
+      if(!result.ok)
+      {
+        progress->addError("Parse OBJ error: ");
+        progress->addError(result.filePath + ": " + result.error);
+      }
+
+      progress->setProgress(float(done)/float(order.size()), "Loaded: " + result.filePath);
+    }
+  });
+
+  if(options.stats)
+    for(const auto& result : results)
+      options.stats->add(result.stats);
+
+  return results;
 }
 
 //##################################################################################################
@@ -0,0 +1,233 @@
+#include "tp_obj/Tokenizer.h"
+
+#include "tp_utils/FileUtils.h"
+
+#include <cstring>
+
+#if defined(_WIN32)
+#  ifndef NOMINMAX
+#    define NOMINMAX
+#  endif
+#  include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#  define TP_OBJ_MMAP
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
+namespace tp_obj
+{
+
+namespace
+{
+//##################################################################################################
+inline bool isSpace(char c)
+{
+  return c==' ' || c=='\t' || c=='\r' || c=='\f' || c=='\v';
+}
+}
+
+//##################################################################################################
+struct MappedFile::Private
+{
+  bool valid{false};
+  const char* data{nullptr};
+  size_t size{0};
+
+#if defined(_WIN32)
+  HANDLE file{INVALID_HANDLE_VALUE};
+  HANDLE mapping{nullptr};
+#elif defined(TP_OBJ_MMAP)
+  void* mapped{nullptr};
+#else
+  std::string buffer;
+#endif
+};
+
+//##################################################################################################
+MappedFile::MappedFile(const std::string& filePath):
+  d(new Private())
+{
+#if defined(_WIN32)
+  d->file = CreateFileA(filePath.c_str(),
+                        GENERIC_READ,
+                        FILE_SHARE_READ,
+                        nullptr,
+                        OPEN_EXISTING,
+                        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+                        nullptr);
+  if(d->file == INVALID_HANDLE_VALUE)
+    return;
+
+  LARGE_INTEGER size;
+  if(!GetFileSizeEx(d->file, &size))
+    return;
+
+  d->valid = true;
+  d->size = size_t(size.QuadPart);
+  if(d->size == 0)
+    return;
+
+  d->mapping = CreateFileMappingA(d->file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if(!d->mapping)
+  {
+    d->valid = false;
+    d->size = 0;
+    return;
+  }
+
+  d->data = static_cast<const char*>(MapViewOfFile(d->mapping, FILE_MAP_READ, 0, 0, 0));
+  if(!d->data)
+  {
+    d->valid = false;
+    d->size = 0;
+  }
+#elif defined(TP_OBJ_MMAP)
+  int fd = ::open(filePath.c_str(), O_RDONLY);
+  if(fd<0)
+    return;
+
+  struct stat st;
+  if(::fstat(fd, &st) == 0 && S_ISREG(st.st_mode))
+  {
+    d->valid = true;
+    d->size = size_t(st.st_size);
+    if(d->size>0)
+    {
+      d->mapped = ::mmap(nullptr, d->size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if(d->mapped == MAP_FAILED)
+      {
+        d->mapped = nullptr;
+        d->valid = false;
+        d->size = 0;
+      }
+      else
+      {
+        ::madvise(d->mapped, d->size, MADV_SEQUENTIAL);
+        d->data = static_cast<const char*>(d->mapped);
+      }
+    }
+  }
+
+  ::close(fd);
+#else
+  if(tp_utils::exists(filePath))
+  {
+    d->buffer = tp_utils::readTextFile(filePath);
+    d->valid = true;
+    d->data = d->buffer.data();
+    d->size = d->buffer.size();
+  }
+#endif
+}
+
+//##################################################################################################
+MappedFile::~MappedFile()
+{
+#if defined(_WIN32)
+  if(d->data)
+    UnmapViewOfFile(d->data);
+  if(d->mapping)
+    CloseHandle(d->mapping);
+  if(d->file != INVALID_HANDLE_VALUE)
+    CloseHandle(d->file);
+#elif defined(TP_OBJ_MMAP)
+  if(d->mapped)
+    ::munmap(d->mapped, d->size);
+#endif
+
+  delete d;
+}
+
+//##################################################################################################
+bool MappedFile::isValid() const
+{
+  return d->valid;
+}
+
+//##################################################################################################
+std::string_view MappedFile::text() const
+{
+  return {d->data, d->size};
+}
+
+//##################################################################################################
+LineTokenizer::LineTokenizer(std::string_view text, std::string* exporterVersion):
+  m_text(text),
+  m_exporterVersion(exporterVersion)
+{
+  m_parts.reserve(8);
+}
+
+//##################################################################################################
+bool LineTokenizer::next()
+{
+  const char* begin = m_text.data();
+  const char* end = begin + m_text.size();
+
+  while(m_position<m_text.size())
+  {
+    const char* lineStart = begin + m_position;
+    const char* lineEnd = static_cast<const char*>(std::memchr(lineStart, '\n', size_t(end-lineStart)));
+    if(!lineEnd)
+      lineEnd = end;
+
+    m_position = size_t(lineEnd-begin) + ((lineEnd<end)?1:0);
+
+    if(const char* hash = static_cast<const char*>(std::memchr(lineStart, '#', size_t(lineEnd-lineStart))); hash)
+    {
+      if(m_exporterVersion && hash == lineStart)
+      {
+        constexpr std::string_view exporterVersionPrefix = "# OMI OBJ exporter v";
+        std::string_view line(lineStart, size_t(lineEnd-lineStart));
+        if(line.substr(0, exporterVersionPrefix.size()) == exporterVersionPrefix)
+        {
+          m_exporterVersion->assign(line.substr(exporterVersionPrefix.size()));
+          tpRemoveChar(*m_exporterVersion, '\r');
+        }
+      }
+
+      lineEnd = hash;
+    }
+
+    m_parts.clear();
+    const char* c = lineStart;
+    for(;;)
+    {
+      while(c<lineEnd && isSpace(*c))
+        c++;
+
+      if(c==lineEnd)
+        break;
+
+      const char* tokenStart = c;
+      while(c<lineEnd && !isSpace(*c))
+        c++;
+
+      m_parts.emplace_back(tokenStart, size_t(c-tokenStart));
+    }
+
+    if(!m_parts.empty())
+      return true;
+  }
+
+  m_parts.clear();
+  return false;
+}
+
+//##################################################################################################
+std::string joinName(const std::vector<std::string_view>& parts)
+{
+  std::string name;
+  for(size_t i=1; i<parts.size(); i++)
+  {
+    if(!name.empty())
+      name+=' ';
+    name += parts.at(i);
+  }
+  return name;
+}
+
+}
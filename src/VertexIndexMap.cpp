@@ -0,0 +1,96 @@
+#include "tp_obj/VertexIndexMap.h"
+
+#include <algorithm>
+
+namespace tp_obj
+{
+
+//##################################################################################################
+VertexIndexMap::VertexIndexMap(std::pmr::memory_resource* resource):
+  m_slots(resource),
+  m_direct(resource)
+{
+
+}
+
+//##################################################################################################
+void VertexIndexMap::clear()
+{
+  m_size = 0;
+  m_directSize = 0;
+
+  if(++m_generation == 0)
+    resetGenerations();
+}
+
+//##################################################################################################
+void VertexIndexMap::insert(size_t vvi, size_t vti, size_t vni, int index)
+{
+  if(vvi==vti && vvi==vni)
+  {
+    if(m_directSize==0)
+      m_directBase = vvi;
+
+    // find() checks the direct table and then the hash table, so it does not matter that the
+    // window grows as entries are added.
+    size_t window = std::max(minDirectWindow, (m_directSize+1)*directWindowFactor);
+    if(vvi>=m_directBase && vvi-m_directBase<window)
+    {
+      size_t d=vvi-m_directBase;
+      if(d>=m_direct.size())
+        m_direct.resize(std::min(window, std::max(d+1, m_direct.size()*2)));
+
+      m_direct[d].generation = m_generation;
+      m_direct[d].index = index;
+      m_directSize++;
+      return;
+    }
+  }
+
+  // Keep the load factor at or below a half.
+  if((m_size+1)*2 > m_slots.size())
+    grow();
+
+  size_t s=hash(vvi, vti, vni)&m_mask;
+  while(m_slots[s].generation==m_generation)
+    s=(s+1)&m_mask;
+
+  m_slots[s] = {vvi, vti, vni, m_generation, index};
+  m_size++;
+}
+
+//##################################################################################################
+void VertexIndexMap::grow()
+{
+  std::pmr::vector<Slot> slots(std::max(size_t(16), m_slots.size()*2), Slot{0, 0, 0, 0, -1}, m_slots.get_allocator());
+  size_t mask = slots.size()-1;
+
+  for(const auto& slot : m_slots)
+  {
+    if(slot.generation!=m_generation)
+      continue;
+
+    size_t s=hash(slot.vvi, slot.vti, slot.vni)&mask;
+    while(slots[s].generation==m_generation)
+      s=(s+1)&mask;
+
+    slots[s] = slot;
+  }
+
+  m_slots.swap(slots);
+  m_mask = mask;
+}
+
+//##################################################################################################
+void VertexIndexMap::resetGenerations()
+{
+  for(auto& slot : m_slots)
+    slot.generation = 0;
+
+  for(auto& slot : m_direct)
+    slot.generation = 0;
+
+  m_generation = 1;
+}
+
+}
@@ -0,0 +1,275 @@
+#include "tp_obj/VertexOrder.h"
+#include "tp_obj/OBJMeshBuffers.h"
+#include "tp_obj/Parallel.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace tp_obj
+{
+
+namespace
+{
+
+//##################################################################################################
+//! Reorders the triangles of index lists, the buffers are kept between lists.
+class Tipsify
+{
+public:
+  //################################################################################################
+  //! Reorder count indexes, each index minus base must be less than vertexCount.
+  template<typename Index>
+  void reorder(Index* indexes, size_t count, size_t vertexCount, Index base, size_t cacheSize)
+  {
+    size_t triangleCount = count/3;
+    if(triangleCount<2)
+      return;
+
+    // The triangles that use each vert, found with a counting sort.
+    m_live.assign(vertexCount, 0);
+    for(size_t i=0; i<triangleCount*3; i++)
+      m_live[size_t(indexes[i]-base)]++;
+
+    m_offsets.resize(vertexCount+1);
+    m_offsets[0] = 0;
+    for(size_t v=0; v<vertexCount; v++)
+      m_offsets[v+1] = m_offsets[v] + m_live[v];
+
+    m_adjacency.resize(triangleCount*3);
+    m_fill.assign(m_offsets.begin(), m_offsets.end()-1);
+    for(size_t i=0; i<triangleCount*3; i++)
+      m_adjacency[m_fill[size_t(indexes[i]-base)]++] = i/3;
+
+    m_cacheTime.assign(vertexCount, 0);
+    m_emitted.assign(triangleCount, false);
+    m_deadEnd.clear();
+    m_order.clear();
+
+    size_t time = cacheSize+1;
+    size_t cursor = 0;
+    size_t fan = size_t(indexes[0]-base);
+    while(fan!=SIZE_MAX)
+    {
+      // Emit every triangle around the fanning vert, the verts of them are the candidates for the
+      // next fanning vert.
+      m_candidates.clear();
+      for(size_t a=m_offsets[fan]; a<m_offsets[fan+1]; a++)
+      {
+        size_t t = m_adjacency[a];
+        if(m_emitted[t])
+          continue;
+
+        m_emitted[t] = true;
+        m_order.push_back(t);
+
+        for(size_t c=0; c<3; c++)
+        {
+          size_t v = size_t(indexes[t*3+c]-base);
+          m_deadEnd.push_back(v);
+          m_candidates.push_back(v);
+          m_live[v]--;
+          if(time-m_cacheTime[v]>cacheSize)
+            m_cacheTime[v] = time++;
+        }
+      }
+
+      fan = nextVertex(time, cacheSize, cursor, vertexCount);
+    }
+
+    m_reordered.resize(triangleCount*3);
+    for(size_t i=0; i<m_order.size(); i++)
+      for(size_t c=0; c<3; c++)
+        m_reordered[i*3+c] = size_t(indexes[m_order[i]*3+c]-base);
+
+    for(size_t i=0; i<m_reordered.size(); i++)
+      indexes[i] = Index(m_reordered[i]) + base;
+  }
+
+private:
+  //################################################################################################
+  //! Pick the candidate that stays in the cache the longest while its triangles are emitted.
+  size_t nextVertex(size_t time, size_t cacheSize, size_t& cursor, size_t vertexCount)
+  {
+    size_t best=SIZE_MAX;
+    size_t bestPriority=0;
+    for(size_t v : m_candidates)
+    {
+      if(m_live[v]==0)
+        continue;
+
+      size_t priority=0;
+      if(time-m_cacheTime[v]+2*m_live[v]<=cacheSize)
+        priority = time-m_cacheTime[v];
+
+      if(best==SIZE_MAX || priority>bestPriority)
+      {
+        best = v;
+        bestPriority = priority;
+      }
+    }
+
+    if(best!=SIZE_MAX)
+      return best;
+
+    // Nothing in the cache has triangles left, try the recently used verts then the rest in order.
+    while(!m_deadEnd.empty())
+    {
+      size_t v = m_deadEnd.back();
+      m_deadEnd.pop_back();
+      if(m_live[v]>0)
+        return v;
+    }
+
+    for(; cursor<vertexCount; cursor++)
+      if(m_live[cursor]>0)
+        return cursor;
+
+    return SIZE_MAX;
+  }
+
+  std::vector<size_t> m_live;
+  std::vector<size_t> m_offsets;
+  std::vector<size_t> m_fill;
+  std::vector<size_t> m_adjacency;
+  std::vector<size_t> m_cacheTime;
+  std::vector<bool> m_emitted;
+  std::vector<size_t> m_deadEnd;
+  std::vector<size_t> m_candidates;
+  std::vector<size_t> m_order;
+  std::vector<size_t> m_reordered;
+};
+
+//##################################################################################################
+//! Number the verts in the order that indexes first use them, remap[old] gives the new index.
+template<typename Index>
+void addFirstUse(const Index* indexes, size_t count, Index base, std::vector<size_t>& remap, size_t& next)
+{
+  for(size_t i=0; i<count; i++)
+    if(size_t& r = remap[size_t(indexes[i]-base)]; r==SIZE_MAX)
+      r = next++;
+}
+
+//##################################################################################################
+//! Give the verts that no triangle uses the indexes after the used ones.
+void finishRemap(std::vector<size_t>& remap, size_t next)
+{
+  for(auto& r : remap)
+    if(r==SIZE_MAX)
+      r = next++;
+}
+
+//##################################################################################################
+//! Move each item to remap[i] using scratch as a copy of the items.
+template<typename T>
+void permute(T* items, const std::vector<size_t>& remap, std::vector<T>& scratch)
+{
+  scratch.assign(items, items+remap.size());
+  for(size_t i=0; i<remap.size(); i++)
+    items[remap[i]] = scratch[i];
+}
+
+}
+
+//##################################################################################################
+void optimizeVertexOrder(tp_math_utils::Geometry3D& geometry, size_t cacheSize)
+{
+  size_t vertexCount = geometry.verts.size();
+  if(vertexCount==0)
+    return;
+
+  Tipsify tipsify;
+  for(auto& f : geometry.indexes)
+    if(f.type==geometry.triangles)
+      tipsify.reorder(f.indexes.data(), f.indexes.size(), vertexCount, 0, cacheSize);
+
+  std::vector<size_t> remap(vertexCount, SIZE_MAX);
+  size_t next=0;
+  for(const auto& f : geometry.indexes)
+    addFirstUse(f.indexes.data(), f.indexes.size(), 0, remap, next);
+  finishRemap(remap, next);
+
+  for(auto& f : geometry.indexes)
+    for(auto& i : f.indexes)
+      i = int(remap[size_t(i)]);
+
+  std::vector<tp_math_utils::Vertex3D> scratch;
+  permute(geometry.verts.data(), remap, scratch);
+}
+
+//##################################################################################################
+void optimizeVertexOrder(std::vector<tp_math_utils::Geometry3D>& geometry,
+                         size_t threadCount,
+                         size_t cacheSize)
+{
+  parallelFor(geometry.size(), resolveThreadCount(threadCount), [&](size_t i)
+  {
+    optimizeVertexOrder(geometry.at(i), cacheSize);
+  });
+}
+
+//##################################################################################################
+void optimizeVertexOrder(OBJMeshBuffers& buffers,
+                         size_t threadCount,
+                         size_t cacheSize)
+{
+  if(!buffers.layout.isValid())
+    return;
+
+  // The submeshes of an object are next to each other and share its range of verts.
+  std::vector<std::pair<size_t, size_t>> objects;
+  for(size_t s=0; s<buffers.submeshes.size(); s++)
+  {
+    if(objects.empty() || buffers.submeshes.at(objects.back().first).firstVertex!=buffers.submeshes.at(s).firstVertex)
+      objects.emplace_back(s, s);
+    objects.back().second = s+1;
+  }
+
+  bool interleaved = buffers.layout.stride>0;
+
+  parallelFor(objects.size(), resolveThreadCount(threadCount), [&](size_t o)
+  {
+    auto [firstSubmesh, endSubmesh] = objects.at(o);
+    size_t firstVertex = buffers.submeshes.at(firstSubmesh).firstVertex;
+    size_t vertexCount = buffers.submeshes.at(firstSubmesh).vertexCount;
+    auto base = uint32_t(firstVertex);
+
+    Tipsify tipsify;
+    std::vector<size_t> remap(vertexCount, SIZE_MAX);
+    size_t next=0;
+    for(size_t s=firstSubmesh; s<endSubmesh; s++)
+    {
+      const auto& submesh = buffers.submeshes.at(s);
+      uint32_t* indexes = buffers.indexes.data() + submesh.firstIndex;
+      tipsify.reorder(indexes, submesh.indexCount, vertexCount, base, cacheSize);
+      addFirstUse(indexes, submesh.indexCount, base, remap, next);
+    }
+    finishRemap(remap, next);
+
+    for(size_t s=firstSubmesh; s<endSubmesh; s++)
+    {
+      const auto& submesh = buffers.submeshes.at(s);
+      uint32_t* indexes = buffers.indexes.data() + submesh.firstIndex;
+      for(size_t i=0; i<submesh.indexCount; i++)
+        indexes[i] = base + uint32_t(remap[indexes[i]-base]);
+    }
+
+    if(interleaved)
+    {
+      size_t stride = buffers.layout.stride;
+      uint8_t* vertices = buffers.vertices.data() + firstVertex*stride;
+      std::vector<uint8_t> scratch(vertices, vertices+vertexCount*stride);
+      for(size_t i=0; i<vertexCount; i++)
+        std::memcpy(vertices + remap[i]*stride, scratch.data() + i*stride, stride);
+    }
+    else
+    {
+      std::vector<glm::vec3> scratch3;
+      std::vector<glm::vec2> scratch2;
+      permute(buffers.positions.data()+firstVertex, remap, scratch3);
+      permute(buffers.texCoords.data()+firstVertex, remap, scratch2);
+      permute(buffers.normals  .data()+firstVertex, remap, scratch3);
+    }
+  });
+}
+
+}
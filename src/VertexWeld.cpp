@@ -0,0 +1,365 @@
+#include "tp_obj/VertexWeld.h"
+#include "tp_obj/OBJMeshBuffers.h"
+#include "tp_obj/Parallel.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace tp_obj
+{
+
+namespace
+{
+
+//##################################################################################################
+//! The attributes of a vert that are compared when welding.
+struct WeldVertex
+{
+  glm::vec3 position{0.0f};
+  glm::vec2 texCoord{0.0f};
+  glm::vec3 normal{0.0f};
+};
+
+//##################################################################################################
+//! Finds which verts to merge, the buffers are kept between meshes.
+class WeldGrid
+{
+public:
+  //################################################################################################
+  WeldGrid(const WeldTolerances& tolerances):
+    m_tolerances(tolerances),
+    m_cellSize(double(tolerances.position))
+  {
+
+  }
+
+  //################################################################################################
+  //! Fill remap with the new index of each of count verts, keepers gets the old index of each kept
+  //! vert in order.
+  template<typename GetVertex>
+  void weld(size_t count, const GetVertex& getVertex, std::vector<size_t>& remap, std::vector<size_t>& keepers)
+  {
+    remap.resize(count);
+    keepers.clear();
+    m_kept.clear();
+    m_next.clear();
+    m_heads.clear();
+    m_heads.reserve(count);
+
+    // Verts further apart than the cell size can't be merged so only the neighbouring cells need
+    // to be searched, with no tolerance only the cell that the vert falls in can hold a match.
+    int reach = (m_tolerances.position>0.0f)?1:0;
+
+    for(size_t i=0; i<count; i++)
+    {
+      WeldVertex v = getVertex(i);
+      int64_t cx = cell(v.position.x);
+      int64_t cy = cell(v.position.y);
+      int64_t cz = cell(v.position.z);
+
+      size_t match = SIZE_MAX;
+      for(int dz=-reach; dz<=reach && match==SIZE_MAX; dz++)
+      {
+        for(int dy=-reach; dy<=reach && match==SIZE_MAX; dy++)
+        {
+          for(int dx=-reach; dx<=reach && match==SIZE_MAX; dx++)
+          {
+            auto h = m_heads.find(key(cx+dx, cy+dy, cz+dz));
+            if(h==m_heads.end())
+              continue;
+
+            // Different cells can share a key so every candidate is checked.
+            for(size_t k=h->second; k!=SIZE_MAX; k=m_next[k])
+            {
+              if(matches(m_kept[k], v))
+              {
+                match = k;
+                break;
+              }
+            }
+          }
+        }
+      }
+
+      if(match==SIZE_MAX)
+      {
+        match = keepers.size();
+        keepers.push_back(i);
+        m_kept.push_back(v);
+
+        auto& head = m_heads.try_emplace(key(cx, cy, cz), SIZE_MAX).first->second;
+        m_next.push_back(head);
+        head = match;
+      }
+
+      remap[i] = match;
+    }
+  }
+
+private:
+  //################################################################################################
+  int64_t cell(float value) const
+  {
+    // With no tolerance only equal positions match, so each position gets a cell of its own.
+    if(m_tolerances.position<=0.0f)
+    {
+      uint32_t bits=0;
+      value += 0.0f;
+      std::memcpy(&bits, &value, sizeof(bits));
+      return int64_t(bits);
+    }
+
+    double c = std::floor(double(value)/m_cellSize);
+    constexpr double limit = 4.0e18;
+    return (c>limit)?int64_t(limit):((c<-limit || std::isnan(c))?int64_t(-limit):int64_t(c));
+  }
+
+  //################################################################################################
+  static uint64_t key(int64_t x, int64_t y, int64_t z)
+  {
+    return (uint64_t(x)*73856093u) ^ (uint64_t(y)*19349663u) ^ (uint64_t(z)*83492791u);
+  }
+
+  //################################################################################################
+  static bool within(const glm::vec2& a, const glm::vec2& b, float tolerance)
+  {
+    glm::vec2 d = a-b;
+    return d.x*d.x + d.y*d.y <= tolerance*tolerance;
+  }
+
+  //################################################################################################
+  static bool within(const glm::vec3& a, const glm::vec3& b, float tolerance)
+  {
+    glm::vec3 d = a-b;
+    return d.x*d.x + d.y*d.y + d.z*d.z <= tolerance*tolerance;
+  }
+
+  //################################################################################################
+  bool matches(const WeldVertex& a, const WeldVertex& b) const
+  {
+    return within(a.position, b.position, m_tolerances.position) &&
+           within(a.texCoord, b.texCoord, m_tolerances.texCoord) &&
+           within(a.normal  , b.normal  , m_tolerances.normal  );
+  }
+
+  WeldTolerances m_tolerances;
+  double m_cellSize;
+  std::vector<WeldVertex> m_kept;
+  std::vector<size_t> m_next;
+  std::unordered_map<uint64_t, size_t> m_heads;
+};
+
+//##################################################################################################
+//! Remap count indexes in place and drop triangles that lost a corner, returns the new count.
+template<typename Index, typename Remap>
+size_t remapTriangles(Index* indexes, size_t count, const Remap& remap)
+{
+  size_t out=0;
+  size_t i=0;
+  for(; i+2<count; i+=3)
+  {
+    Index a = remap(indexes[i  ]);
+    Index b = remap(indexes[i+1]);
+    Index c = remap(indexes[i+2]);
+    if(a==b || b==c || c==a)
+      continue;
+
+    indexes[out++] = a;
+    indexes[out++] = b;
+    indexes[out++] = c;
+  }
+
+  // An incomplete triangle at the end is left as it was.
+  for(; i<count; i++)
+    indexes[out++] = remap(indexes[i]);
+
+  return out;
+}
+
+//##################################################################################################
+//! Read a value at offset from a vertex, value is left as it is if the offset is -1.
+template<typename T>
+void read(const uint8_t* vertex, int offset, T& value)
+{
+  if(offset>=0)
+    std::memcpy(&value, vertex+offset, sizeof(T));
+}
+
+}
+
+//##################################################################################################
+size_t weldVertices(tp_math_utils::Geometry3D& geometry,
+                    const WeldTolerances& tolerances)
+{
+  size_t count = geometry.verts.size();
+  if(count<2)
+    return 0;
+
+  std::vector<size_t> remap;
+  std::vector<size_t> keepers;
+  WeldGrid grid(tolerances);
+  grid.weld(count, [&](size_t i)
+  {
+    const auto& v = geometry.verts[i];
+    return WeldVertex{v.vert, v.texture, v.normal};
+  }, remap, keepers);
+
+  if(keepers.size()==count)
+    return 0;
+
+  // Keepers never move forward so the verts can be compacted in place.
+  for(size_t k=0; k<keepers.size(); k++)
+    geometry.verts[k] = geometry.verts[keepers[k]];
+  geometry.verts.resize(keepers.size());
+
+  auto remapIndex = [&](int i)
+  {
+    return int(remap[size_t(i)]);
+  };
+
+  for(auto& f : geometry.indexes)
+  {
+    if(f.type==geometry.triangles)
+      f.indexes.resize(remapTriangles(f.indexes.data(), f.indexes.size(), remapIndex));
+    else
+      for(auto& i : f.indexes)
+        i = remapIndex(i);
+  }
+
+  return count - keepers.size();
+}
+
+//##################################################################################################
+size_t weldVertices(std::vector<tp_math_utils::Geometry3D>& geometry,
+                    const WeldTolerances& tolerances,
+                    size_t threadCount)
+{
+  std::atomic<size_t> removed{0};
+  parallelFor(geometry.size(), resolveThreadCount(threadCount), [&](size_t i)
+  {
+    removed += weldVertices(geometry.at(i), tolerances);
+  });
+  return removed;
+}
+
+//##################################################################################################
+size_t weldVertices(OBJMeshBuffers& buffers,
+                    const WeldTolerances& tolerances,
+                    size_t threadCount)
+{
+  if(!buffers.layout.isValid())
+    return 0;
+
+  // The submeshes of an object are next to each other and share its range of verts.
+  struct Object
+  {
+    size_t firstSubmesh{0};
+    size_t endSubmesh{0};
+    size_t firstVertex{0};
+    size_t vertexCount{0};
+    std::vector<size_t> remap;
+    std::vector<size_t> keepers;
+  };
+
+  std::vector<Object> objects;
+  for(size_t s=0; s<buffers.submeshes.size(); s++)
+  {
+    const auto& submesh = buffers.submeshes.at(s);
+    if(objects.empty() || objects.back().firstVertex!=submesh.firstVertex)
+    {
+      auto& object = objects.emplace_back();
+      object.firstSubmesh = s;
+      object.firstVertex = submesh.firstVertex;
+      object.vertexCount = submesh.vertexCount;
+    }
+    objects.back().endSubmesh = s+1;
+  }
+
+  const auto& layout = buffers.layout;
+  bool interleaved = layout.stride>0;
+
+  //-- Find the verts to merge in each object ------------------------------------------------------
+  parallelFor(objects.size(), resolveThreadCount(threadCount), [&](size_t o)
+  {
+    auto& object = objects.at(o);
+    WeldGrid grid(tolerances);
+    grid.weld(object.vertexCount, [&](size_t i)
+    {
+      size_t index = object.firstVertex + i;
+      WeldVertex v;
+      if(interleaved)
+      {
+        const uint8_t* vertex = buffers.vertices.data() + index*layout.stride;
+        read(vertex, layout.positionOffset, v.position);
+        read(vertex, layout.texCoordOffset, v.texCoord);
+        read(vertex, layout.normalOffset  , v.normal  );
+      }
+      else
+      {
+        v.position = buffers.positions[index];
+        v.texCoord = buffers.texCoords[index];
+        v.normal   = buffers.normals  [index];
+      }
+      return v;
+    }, object.remap, object.keepers);
+  });
+
+  //-- Compact the verts and indexes ---------------------------------------------------------------
+  // Objects and the verts kept in them stay in order so everything only moves towards the start.
+  size_t vertexCount=0;
+  size_t indexCount=0;
+  for(auto& object : objects)
+  {
+    for(size_t k=0; k<object.keepers.size(); k++)
+    {
+      size_t from = object.firstVertex + object.keepers[k];
+      size_t to = vertexCount + k;
+      if(interleaved)
+        std::memmove(buffers.vertices.data() + to*layout.stride, buffers.vertices.data() + from*layout.stride, layout.stride);
+      else
+      {
+        buffers.positions[to] = buffers.positions[from];
+        buffers.texCoords[to] = buffers.texCoords[from];
+        buffers.normals  [to] = buffers.normals  [from];
+      }
+    }
+
+    auto remapIndex = [&](uint32_t i)
+    {
+      return uint32_t(vertexCount + object.remap[i - object.firstVertex]);
+    };
+
+    for(size_t s=object.firstSubmesh; s<object.endSubmesh; s++)
+    {
+      auto& submesh = buffers.submeshes.at(s);
+      uint32_t* indexes = buffers.indexes.data() + indexCount;
+      std::memmove(indexes, buffers.indexes.data() + submesh.firstIndex, submesh.indexCount*sizeof(uint32_t));
+
+      submesh.firstIndex = indexCount;
+      submesh.indexCount = remapTriangles(indexes, submesh.indexCount, remapIndex);
+      submesh.firstVertex = vertexCount;
+      submesh.vertexCount = object.keepers.size();
+      indexCount += submesh.indexCount;
+    }
+
+    vertexCount += object.keepers.size();
+  }
+
+  size_t removed = buffers.vertexCount - vertexCount;
+  buffers.vertexCount = vertexCount;
+  buffers.indexes.resize(indexCount);
+  if(interleaved)
+    buffers.vertices.resize(vertexCount*layout.stride);
+  else
+  {
+    buffers.positions.resize(vertexCount);
+    buffers.texCoords.resize(vertexCount);
+    buffers.normals  .resize(vertexCount);
+  }
+
+  return removed;
+}
+
+}
@@ -1,14 +1,453 @@
 #include "tp_obj/WriteOBJ.h"
+#include "tp_obj/OBJStats.h"
+#include "tp_obj/Parallel.h"
 
 #include "tp_math_utils/materials/OpenGLMaterial.h"
 
 #include "tp_utils/FileUtils.h"
 
 #include <sstream>
+#include <cstring>
+#include <atomic>
+#include <memory_resource>
 
 namespace tp_obj
 {
 
+namespace
+{
+
+//##################################################################################################
+//! Assigns consecutive indexes to unique values, values are compared by their bit patterns.
+template<typename T>
+class UniqueValues
+{
+  static_assert(sizeof(T)%sizeof(uint32_t)==0);
+public:
+  //################################################################################################
+  UniqueValues(std::pmr::memory_resource* resource):
+    values(resource),
+    m_slots(resource)
+  {
+
+  }
+
+  //################################################################################################
+  //! Returns the index of value, adding it if it is new.
+  int add(const T& value)
+  {
+    // Keep the load factor at or below a half.
+    if((values.size()+1)*2 > m_slots.size())
+      grow();
+
+    for(size_t s=hash(value)&m_mask;; s=(s+1)&m_mask)
+    {
+      int& slot = m_slots[s];
+      if(slot<0)
+      {
+        slot = int(values.size());
+        values.push_back(value);
+        return slot;
+      }
+
+      if(std::memcmp(&values[size_t(slot)], &value, sizeof(T))==0)
+        return slot;
+    }
+  }
+
+  std::pmr::vector<T> values;
+
+private:
+  //################################################################################################
+  static size_t hash(const T& value)
+  {
+    uint32_t words[sizeof(T)/sizeof(uint32_t)];
+    std::memcpy(words, &value, sizeof(T));
+
+    uint64_t h=0;
+    for(uint32_t w : words)
+      h = (h ^ w) * 0x9E3779B97F4A7C15ull;
+    return size_t(h ^ (h>>29));
+  }
+
+  //################################################################################################
+  void grow()
+  {
+    m_slots.assign(std::max(size_t(16), m_slots.size()*2), -1);
+    m_mask = m_slots.size()-1;
+
+    for(size_t i=0; i<values.size(); i++)
+    {
+      size_t s=hash(values[i])&m_mask;
+      while(m_slots[s]>=0)
+        s=(s+1)&m_mask;
+      m_slots[s] = int(i);
+    }
+  }
+
+  std::pmr::vector<int> m_slots;
+  size_t m_mask{0};
+};
+
+//##################################################################################################
+//! Returns true if any tex coord differs from the default that is used when vt is missing.
+bool hasTexCoords(const tp_math_utils::Geometry3D& mesh)
+{
+  const glm::vec2 missing = tp_math_utils::Vertex3D().texture;
+  for(const auto& vert : mesh.verts)
+    if(vert.texture!=missing)
+      return true;
+  return false;
+}
+
+//##################################################################################################
+//! Returns true if any normal differs from the default that is used when vn is missing.
+bool hasNormals(const tp_math_utils::Geometry3D& mesh)
+{
+  const glm::vec3 missing = tp_math_utils::Vertex3D().normal;
+  for(const auto& vert : mesh.verts)
+    if(vert.normal!=missing)
+      return true;
+  return false;
+}
+
+//##################################################################################################
+void appendVec3(OutputBuffer& output, std::string_view prefix, const glm::vec3& v, int precision)
+{
+  output.append(prefix);
+  output.appendFloat(v.x, precision);
+  output.append(' ');
+  output.appendFloat(v.y, precision);
+  output.append(' ');
+  output.appendFloat(v.z, precision);
+  output.append('\n');
+}
+
+//##################################################################################################
+void appendVec2(OutputBuffer& output, std::string_view prefix, const glm::vec2& v, int precision)
+{
+  output.append(prefix);
+  output.appendFloat(v.x, precision);
+  output.append(' ');
+  output.appendFloat(v.y, precision);
+  output.append('\n');
+}
+
+//##################################################################################################
+//! Write each unique position, tex coord, and normal once and index them separately in the faces.
+void serializeDeduplicated(OutputBuffer& output,
+                           const std::vector<tp_math_utils::Geometry3D>& geometry,
+                           const WriteOptions& options,
+                           size_t& faces)
+{
+  int precision = options.precision;
+
+  // The tables are freed in one go when the arena goes out of scope.
+  std::pmr::monotonic_buffer_resource arena(options.memoryResource?options.memoryResource:std::pmr::get_default_resource());
+
+  UniqueValues<glm::vec3> positions(&arena);
+  UniqueValues<glm::vec2> texCoords(&arena);
+  UniqueValues<glm::vec3> normals(&arena);
+
+  // The 1 based OBJ indexes of each vert, 0 where the mesh has no tex coords or normals.
+  struct Corner
+  {
+    int v;
+    int vt;
+    int vn;
+  };
+
+  std::pmr::vector<std::pmr::vector<Corner>> meshCorners(geometry.size(), &arena);
+  for(size_t m=0; m<geometry.size(); m++)
+  {
+    const auto& mesh = geometry.at(m);
+    bool vt = hasTexCoords(mesh);
+    bool vn = hasNormals(mesh);
+
+    auto& corners = meshCorners.at(m);
+    corners.reserve(mesh.verts.size());
+    for(const auto& vert : mesh.verts)
+    {
+      Corner& corner = corners.emplace_back();
+      corner.v  = positions.add(vert.vert)+1;
+      corner.vt = vt?texCoords.add(vert.texture)+1:0;
+      corner.vn = vn?normals.add(vert.normal)+1:0;
+    }
+  }
+
+  for(const auto& v : positions.values)
+    appendVec3(output, "v ", v, precision);
+
+  for(const auto& vt : texCoords.values)
+    appendVec2(output, "vt ", vt, precision);
+
+  for(const auto& vn : normals.values)
+    appendVec3(output, "vn ", vn, precision);
+
+  auto corner = [&](const Corner& c)
+  {
+    output.appendInt(c.v);
+
+    if(c.vt || c.vn)
+    {
+      output.append('/');
+      if(c.vt)
+        output.appendInt(c.vt);
+    }
+
+    if(c.vn)
+    {
+      output.append('/');
+      output.appendInt(c.vn);
+    }
+  };
+
+  for(size_t m=0; m<geometry.size(); m++)
+  {
+    const auto& mesh = geometry.at(m);
+    const auto& corners = meshCorners.at(m);
+
+    output.append("usemtl ");
+    output.append(mesh.material.name.toString());
+    output.append('\n');
+
+    for(const auto& indexes : mesh.indexes)
+    {
+      size_t i = 0;
+      size_t iMax = indexes.indexes.size();
+      for(; (i+2)<iMax; i+=3)
+      {
+        output.append("f ");
+        corner(corners.at(size_t(indexes.indexes.at(i+0))));
+        output.append(' ');
+        corner(corners.at(size_t(indexes.indexes.at(i+1))));
+        output.append(' ');
+        corner(corners.at(size_t(indexes.indexes.at(i+2))));
+        output.append('\n');
+        faces++;
+      }
+    }
+  }
+
+  if(options.stats)
+  {
+    options.stats->positions += positions.values.size();
+    options.stats->texCoords += texCoords.values.size();
+    options.stats->normals += normals.values.size();
+  }
+}
+
+//##################################################################################################
+//! A part of the OBJ text that can be formatted independently of the rest.
+struct Piece
+{
+  enum class Type
+  {
+    Positions,
+    TexCoords,
+    Normals,
+    Material,
+    Faces
+  };
+
+  Type type;
+  size_t mesh;
+  size_t indexes;  //!< The Indexes3D of the mesh for faces.
+  size_t begin;    //!< The first vert, or triangle for faces.
+  size_t end;
+  int offset;      //!< The verts in the meshes before this one.
+};
+
+//##################################################################################################
+//! The number of verts or triangles in a piece, big enough to amortize the cost of a buffer.
+constexpr size_t pieceSize = 65536;
+
+//##################################################################################################
+//! Split the text after the mtllib line into pieces in file order.
+std::vector<Piece> splitPieces(const std::vector<tp_math_utils::Geometry3D>& geometry)
+{
+  std::vector<Piece> pieces;
+
+  auto addRanges = [&](Piece::Type type, size_t mesh, size_t indexes, size_t count, int offset)
+  {
+    for(size_t begin=0; begin<count; begin+=pieceSize)
+      pieces.push_back({type, mesh, indexes, begin, std::min(count, begin+pieceSize), offset});
+  };
+
+  for(auto type : {Piece::Type::Positions, Piece::Type::TexCoords, Piece::Type::Normals})
+    for(size_t m=0; m<geometry.size(); m++)
+      addRanges(type, m, 0, geometry.at(m).verts.size(), 0);
+
+  int offset=0;
+  for(size_t m=0; m<geometry.size(); m++)
+  {
+    const auto& mesh = geometry.at(m);
+    pieces.push_back({Piece::Type::Material, m, 0, 0, 0, offset});
+
+    for(size_t i=0; i<mesh.indexes.size(); i++)
+      addRanges(Piece::Type::Faces, m, i, mesh.indexes.at(i).indexes.size()/3, offset);
+
+    offset += int(mesh.verts.size());
+  }
+
+  return pieces;
+}
+
+//##################################################################################################
+void formatPiece(OutputBuffer& output,
+                 const Piece& piece,
+                 const std::vector<tp_math_utils::Geometry3D>& geometry,
+                 int precision)
+{
+  const auto& mesh = geometry.at(piece.mesh);
+
+  switch(piece.type)
+  {
+  case Piece::Type::Positions:
+    for(size_t v=piece.begin; v<piece.end; v++)
+      appendVec3(output, "v ", mesh.verts[v].vert, precision);
+    break;
+
+  case Piece::Type::TexCoords:
+    for(size_t v=piece.begin; v<piece.end; v++)
+      appendVec2(output, "vt ", mesh.verts[v].texture, precision);
+    break;
+
+  case Piece::Type::Normals:
+    for(size_t v=piece.begin; v<piece.end; v++)
+      appendVec3(output, "vn ", mesh.verts[v].normal, precision);
+    break;
+
+  case Piece::Type::Material:
+    output.append("usemtl ");
+    output.append(mesh.material.name.toString());
+    output.append('\n');
+    break;
+
+  case Piece::Type::Faces:
+  {
+    auto corner = [&](int i)
+    {
+      output.appendInt(i);
+      output.append('/');
+      output.appendInt(i);
+      output.append('/');
+      output.appendInt(i);
+    };
+
+    const auto& indexes = mesh.indexes.at(piece.indexes).indexes;
+    int offset = piece.offset+1;
+    for(size_t t=piece.begin; t<piece.end; t++)
+    {
+      output.append("f ");
+      corner(indexes.at(t*3+0) + offset);
+      output.append(' ');
+      corner(indexes.at(t*3+1) + offset);
+      output.append(' ');
+      corner(indexes.at(t*3+2) + offset);
+      output.append('\n');
+    }
+    break;
+  }
+  }
+}
+
+//##################################################################################################
+//! Format batches of pieces in parallel and pass them to write in file order.
+/*!
+\param position the position in the output of the first piece, set to the end of the last piece.
+\param parallelWrites if true write is called from several threads for each batch.
+\param writeSeconds if not nullptr the time spent writing is added to this.
+\param resize if set it is called with the end of each batch before the batch is written.
+*/
+bool formatInParallel(const std::vector<tp_math_utils::Geometry3D>& geometry,
+                      const std::vector<Piece>& pieces,
+                      int precision,
+                      size_t threadCount,
+                      std::pmr::memory_resource* resource,
+                      size_t& position,
+                      bool parallelWrites,
+                      double* writeSeconds,
+                      const std::function<bool(size_t)>& resize,
+                      const std::function<bool(size_t, std::string_view)>& write)
+{
+  // Batches keep the memory used by the formatted text bounded.
+  size_t batchCapacity = threadCount*4;
+  std::pmr::vector<std::pmr::string> texts(batchCapacity, resource?resource:std::pmr::get_default_resource());
+  std::vector<size_t> positions(batchCapacity);
+
+  for(size_t batch=0; batch<pieces.size(); batch+=batchCapacity)
+  {
+    size_t batchSize = std::min(batchCapacity, pieces.size()-batch);
+
+    parallelFor(batchSize, threadCount, [&](size_t p)
+    {
+      std::pmr::string& text = texts.at(p);
+      text.clear();
+
+      OutputBuffer output([&](const char* data, size_t size)
+      {
+        text.append(data, size);
+        return true;
+      });
+
+      formatPiece(output, pieces.at(batch+p), geometry, precision);
+    });
+
+    for(size_t p=0; p<batchSize; p++)
+    {
+      positions.at(p) = position;
+      position += texts.at(p).size();
+    }
+
+    OBJStatsTimer timer(writeSeconds);
+    if(resize && !resize(position))
+      return false;
+
+    if(parallelWrites)
+    {
+      std::atomic<bool> ok{true};
+      parallelFor(batchSize, threadCount, [&](size_t p)
+      {
+        if(!write(positions.at(p), texts.at(p)))
+          ok = false;
+      });
+
+      if(!ok)
+        return false;
+    }
+    else
+    {
+      for(size_t p=0; p<batchSize; p++)
+        if(!write(positions.at(p), texts.at(p)))
+          return false;
+    }
+  }
+
+  return true;
+}
+
+//##################################################################################################
+void addPlainStats(OBJStats* stats, const std::vector<tp_math_utils::Geometry3D>& geometry)
+{
+  if(!stats)
+    return;
+
+  for(const auto& mesh : geometry)
+  {
+    stats->positions += mesh.verts.size();
+    stats->texCoords += mesh.verts.size();
+    stats->normals += mesh.verts.size();
+
+    for(const auto& indexes : mesh.indexes)
+      stats->faces += indexes.indexes.size()/3;
+  }
+
+  stats->meshes += geometry.size();
+}
+
+}
+
 //##################################################################################################
 std::string serializeMTL(const std::vector<tp_math_utils::Geometry3D>& geometry)
 {
@@ -39,90 +478,175 @@ std::string serializeMTL(const std::vector<tp_math_utils::Geometry3D>& geometry)
 }
 
 //##################################################################################################
-std::string serializeOBJ(const std::vector<tp_math_utils::Geometry3D>& geometry,
-                         const std::string& mtlName)
+void serializeOBJ(OutputBuffer& output,
+                  const std::vector<tp_math_utils::Geometry3D>& geometry,
+                  const std::string& mtlName,
+                  const WriteOptions& options)
 {
-  std::stringstream result;
+  OBJStats* stats = options.stats;
+  OBJStatsTimer timer(stats?&stats->serializeSeconds:nullptr);
+  size_t startBytes = output.bytesWritten();
+  int precision = options.precision;
 
-  result << "mtllib " << mtlName << "\n";
+  output.append("mtllib ");
+  output.append(mtlName);
+  output.append('\n');
 
-  for(const auto& mesh : geometry)
+  size_t faces=0;
+  if(options.deduplicate)
   {
-    for(const auto& vert : mesh.verts)
+    serializeDeduplicated(output, geometry, options, faces);
+
+    if(stats)
     {
-      const auto v = vert.vert;
-      result << std::fixed << "v " << v.x << ' ' << v.y << ' ' << v.z << '\n';
+      stats->bytes += output.bytesWritten() - startBytes;
+      stats->faces += faces;
+      stats->meshes += geometry.size();
     }
+    return;
   }
 
-  for(const auto& mesh : geometry)
+  size_t threadCount = resolveThreadCount(options.threadCount);
+  std::vector<Piece> pieces = splitPieces(geometry);
+
+  if(threadCount>1)
   {
-    for(const auto& vert : mesh.verts)
+    auto write = [&](size_t, std::string_view text)
     {
-      const auto vt = vert.texture;
-      result << std::fixed << "vt " << vt.x << ' ' << vt.y << '\n';
-    }
+      output.append(text);
+      return true;
+    };
+
+    size_t position=0;
+    formatInParallel(geometry, pieces, precision, threadCount, options.memoryResource, position, false, nullptr, nullptr, write);
+  }
+  else
+  {
+    for(const auto& piece : pieces)
+      formatPiece(output, piece, geometry, precision);
   }
 
-  for(const auto& mesh : geometry)
+  if(stats)
   {
-    for(const auto& vert : mesh.verts)
+    stats->bytes += output.bytesWritten() - startBytes;
+    addPlainStats(stats, geometry);
+  }
+}
+
+//##################################################################################################
+std::string serializeOBJ(const std::vector<tp_math_utils::Geometry3D>& geometry,
+                         const std::string& mtlName,
+                         const WriteOptions& options)
+{
+  std::string result;
+  {
+    OutputBuffer output([&](const char* data, size_t size)
     {
-      const auto vn = vert.normal;
-      result << std::fixed << "vn " << vn.x << ' ' << vn.y << ' ' << vn.z << '\n';
-    }
+      result.append(data, size);
+      return true;
+    });
+    serializeOBJ(output, geometry, mtlName, options);
   }
+  return result;
+}
 
+//##################################################################################################
+bool writeOBJ(const std::string& filename,
+              const std::vector<tp_math_utils::Geometry3D>& geometry,
+              const std::string& mtlName,
+              const WriteOptions& options)
+{
+  OBJStats* stats = options.stats;
+  OBJStatsTimer timer(stats?&stats->totalSeconds:nullptr);
 
-  int offset=0;
-  for(const auto& mesh : geometry)
+  OutputFile file(filename);
+  if(!file.isValid())
+    return false;
+
+  size_t threadCount = resolveThreadCount(options.threadCount);
+  if(threadCount>1 && !options.deduplicate && options.compression==Compression::None)
   {
-    result << "usemtl " << mesh.material.name.toString() << "\n";
-    for(const auto& indexes : mesh.indexes)
+    OBJStatsTimer serializeTimer(stats?&stats->serializeSeconds:nullptr);
+
+    std::string header = "mtllib " + mtlName + "\n";
+    bool ok = file.write(header.data(), header.size());
+
+    // Each batch is written with positioned writes after extending the file to its end, so the
+    // writes never race to extend the file.
+    auto resize = [&](size_t size)
     {
-      size_t i = 0;
-      size_t iMax = indexes.indexes.size();
-      for(; (i+2)<iMax; i+=3)
-      {
-        int i0 = indexes.indexes.at(i+0) + offset+1;
-        int i1 = indexes.indexes.at(i+1) + offset+1;
-        int i2 = indexes.indexes.at(i+2) + offset+1;
+      return file.resize(size);
+    };
 
-        result << "f " << i0 << '/' << i0 <<'/' << i0 <<
-                  ' '  << i1 << '/' << i1 <<'/' << i1 <<
-                  ' '  << i2 << '/' << i2 <<'/' << i2 << '\n';
-      }
+    auto write = [&](size_t position, std::string_view text)
+    {
+      return file.writeAt(position, text.data(), text.size());
+    };
+
+    size_t end = header.size();
+    double* writeSeconds = stats?&stats->ioSeconds:nullptr;
+    ok = ok && formatInParallel(geometry, splitPieces(geometry), options.precision, threadCount, options.memoryResource, end, true, writeSeconds, resize, write);
+
+    if(stats && ok)
+    {
+      stats->bytes += end;
+      addPlainStats(stats, geometry);
     }
 
-    offset += int(mesh.verts.size());
+    return file.close() && ok;
   }
 
-  return result.str();
-}
+  Compressor compressor(options.compression, [&](const char* data, size_t size)
+  {
+    OBJStatsTimer ioTimer(stats?&stats->ioSeconds:nullptr);
+    return file.write(data, size);
+  }, options.compressionLevel);
 
-//##################################################################################################
-void writeOBJ(const std::string& filename,
-              const std::vector<tp_math_utils::Geometry3D>& geometry,
-              const std::string& mtlName)
-{
-  tp_utils::writeTextFile(filename, serializeOBJ(geometry, mtlName));
+  if(!compressor.isValid())
+    return false;
+
+  OutputBuffer output(compressor.sink());
+  serializeOBJ(output, geometry, mtlName, options);
+
+  bool ok = output.flush();
+  ok = compressor.finish() && ok;
+  return file.close() && ok;
 }
 
 //##################################################################################################
-void writeOBJ(const std::string& path,
+bool writeOBJ(const std::string& path,
               const std::string& name,
-              const std::vector<tp_math_utils::Geometry3D>& geometry)
+              const std::vector<tp_math_utils::Geometry3D>& geometry,
+              const WriteOptions& options)
 {
-  std::string objName = name + ".obj";
-  std::string mtlName = name + ".mtl";
-  writeOBJ(tp_utils::pathAppend(path, objName), geometry, mtlName);
-  writeMTL(tp_utils::pathAppend(path, mtlName), geometry);
+  std::string extension = compressionExtension(options.compression);
+  std::string objName = name + ".obj" + extension;
+  std::string mtlName = name + ".mtl" + extension;
+  bool ok = writeOBJ(tp_utils::pathAppend(path, objName), geometry, mtlName, options);
+  ok = writeMTL(tp_utils::pathAppend(path, mtlName), geometry, options) && ok;
+  return ok;
 }
 
 //##################################################################################################
-void writeMTL(const std::string& filename, const std::vector<tp_math_utils::Geometry3D>& geometry)
+bool writeMTL(const std::string& filename,
+              const std::vector<tp_math_utils::Geometry3D>& geometry,
+              const WriteOptions& options)
 {
-  tp_utils::writeTextFile(filename, serializeMTL(geometry));
+  if(options.compression == Compression::None)
+    return tp_utils::writeTextFile(filename, serializeMTL(geometry));
+
+  OutputFile file(filename);
+  if(!file.isValid())
+    return false;
+
+  Compressor compressor(options.compression, file.sink(), options.compressionLevel);
+  if(!compressor.isValid())
+    return false;
+
+  std::string text = serializeMTL(geometry);
+  bool ok = compressor.write(text.data(), text.size());
+  ok = compressor.finish() && ok;
+  return file.close() && ok;
 }
 
 }
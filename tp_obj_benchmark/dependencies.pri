@@ -0,0 +1,2 @@
+DEPENDENCIES += tp_obj
+INCLUDEPATHS += tp_obj/tp_obj_benchmark/inc/
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "tp_obj_benchmark/Corpus.h"
+
+#include "tp_obj/OBJStats.h"
+
+namespace tp_obj_benchmark
+{
+
+//##################################################################################################
+struct BenchmarkOptions
+{
+  size_t iterations{5};   //!< Each operation is timed this many times and the fastest is kept.
+  size_t threadCount{1};  //!< Passed to ParseOptions and WriteOptions.
+  std::string filter;     //!< If not empty only corpus files with this in their name are run.
+};
+
+//##################################################################################################
+//! The timing of one operation on one corpus file.
+struct BenchmarkResult
+{
+  std::string corpus;
+  std::string operation;      //!< The name of the function that was timed.
+  bool ok{false};             //!< False if the operation failed, the timings are then meaningless.
+  size_t bytes{0};            //!< Bytes of text read or written by one run.
+  size_t triangles{0};        //!< Triangles read or written by one run.
+  double minSeconds{0.0};     //!< Fastest run.
+  double meanSeconds{0.0};    //!< Average of all runs.
+  size_t peakRSSBytes{0};     //!< Peak resident set size of the process after the operation.
+  tp_obj::OBJStats stats;     //!< Stats collected during the fastest run.
+
+  //################################################################################################
+  double mbPerSecond() const
+  {
+    return minSeconds>0.0?double(bytes)/(1024.0*1024.0)/minSeconds:0.0;
+  }
+
+  //################################################################################################
+  double trianglesPerSecond() const
+  {
+    return minSeconds>0.0?double(triangles)/minSeconds:0.0;
+  }
+};
+
+//##################################################################################################
+//! Time parseOBJ, parseMTL with and without the cache, serializeOBJ, and serializeMTL on each file.
+std::vector<BenchmarkResult> runBenchmarks(const std::vector<CorpusFile>& corpus,
+                                           const BenchmarkOptions& options);
+
+//##################################################################################################
+//! Format the results as a JSON document that can be stored and compared between releases.
+std::string resultsToJSON(const std::vector<BenchmarkResult>& results,
+                          const BenchmarkOptions& options,
+                          size_t corpusTriangles,
+                          uint64_t seed);
+
+//##################################################################################################
+//! Returns the peak resident set size of the process in bytes, or 0 if it is not available.
+size_t peakRSSBytes();
+
+}
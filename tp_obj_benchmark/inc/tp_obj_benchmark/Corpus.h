@@ -0,0 +1,44 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace tp_obj_benchmark
+{
+
+//##################################################################################################
+//! A generated OBJ file and the MTL file that it references.
+struct CorpusFile
+{
+  std::string name;       //!< Short name used in the results.
+  std::string objPath;    //!< Path of the OBJ file.
+  std::string mtlPath;    //!< Path of the MTL file, empty if the file has no materials.
+  size_t triangles{0};    //!< Triangles in the OBJ file after splitting quads.
+  size_t materials{0};    //!< Materials in the MTL file.
+};
+
+//##################################################################################################
+//! Write a set of synthetic OBJ and MTL files to directory.
+/*!
+The files cover the shapes of data that stress different parts of the parser:
+  - triangle_soup every triangle has its own verts so nothing is shared.
+  - quad_mesh a grid of quads with v/vt/vn indexes, most corners are shared.
+  - many_objects lots of small objects with a usemtl switch every few faces.
+  - large_mtl a small mesh that references an MTL file with thousands of materials.
+  - positions_only faces that only reference positions.
+  - no_normals faces with positions and tex coords but no normals.
+
+The content only depends on triangles and seed, so the same arguments always produce identical
+files on every platform.
+
+\param directory where to write the files, it must already exist.
+\param triangles the approximate number of triangles in each OBJ file.
+\param seed the seed for the random positions.
+\returns the generated files, or an empty list if a file could not be written.
+*/
+std::vector<CorpusFile> generateCorpus(const std::string& directory,
+                                       size_t triangles,
+                                       uint64_t seed=1);
+
+}
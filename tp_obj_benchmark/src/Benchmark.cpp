@@ -0,0 +1,371 @@
+#include "tp_obj_benchmark/Benchmark.h"
+
+#include "tp_obj/OBJParser.h"
+#include "tp_obj/MTLCache.h"
+#include "tp_obj/WriteOBJ.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <cstdio>
+
+#ifdef _WIN32
+#  include <windows.h>
+#  include <psapi.h>
+#else
+#  include <sys/resource.h>
+#endif
+
+namespace tp_obj_benchmark
+{
+
+namespace
+{
+
+// The OpenGL primitive types, the parser only stores these in the meshes.
+constexpr int triangleFan   = 0x0006;
+constexpr int triangleStrip = 0x0005;
+constexpr int triangles     = 0x0004;
+
+//##################################################################################################
+size_t fileSize(const std::string& path)
+{
+  std::error_code ec;
+  auto size = std::filesystem::file_size(path, ec);
+  return ec?0:size_t(size);
+}
+
+//##################################################################################################
+size_t countTriangles(const std::vector<tp_math_utils::Geometry3D>& geometry)
+{
+  size_t count=0;
+  for(const auto& o : geometry)
+    for(const auto& indexes : o.indexes)
+      if(indexes.type == o.triangles)
+        count += indexes.indexes.size()/3;
+  return count;
+}
+
+//##################################################################################################
+//! Run closure iterations times and fill in the timings of the result.
+void measure(BenchmarkResult& result,
+             size_t iterations,
+             const std::function<bool(tp_obj::OBJStats&)>& closure)
+{
+  result.ok = true;
+  result.minSeconds = 0.0;
+  double total=0.0;
+
+  for(size_t i=0; i<std::max(size_t(1), iterations); i++)
+  {
+    tp_obj::OBJStats stats;
+    auto start = std::chrono::steady_clock::now();
+    bool ok = closure(stats);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    result.ok = result.ok && ok;
+    total += seconds;
+    if(i==0 || seconds<result.minSeconds)
+    {
+      result.minSeconds = seconds;
+      result.stats = stats;
+    }
+  }
+
+  result.meanSeconds = total/double(std::max(size_t(1), iterations));
+  result.peakRSSBytes = peakRSSBytes();
+}
+
+//##################################################################################################
+std::string escape(const std::string& text)
+{
+  std::string result;
+  result.reserve(text.size());
+  for(char c : text)
+  {
+    if(c=='"' || c=='\\')
+    {
+      result += '\\';
+      result += c;
+    }
+    else if(uint8_t(c)<0x20)
+    {
+      char buffer[8];
+      std::snprintf(buffer, sizeof(buffer), "\\u%04x", int(c));
+      result += buffer;
+    }
+    else
+      result += c;
+  }
+  return result;
+}
+
+//##################################################################################################
+class JSONObject
+{
+public:
+  //################################################################################################
+  JSONObject(std::string& text, const std::string& indent):
+    m_text(text),
+    m_indent(indent)
+  {
+    m_text += "{";
+  }
+
+  //################################################################################################
+  ~JSONObject()
+  {
+    m_text += "\n" + m_indent + "}";
+  }
+
+  //################################################################################################
+  std::string& key(const std::string& name)
+  {
+    m_text += m_first?"\n":",\n";
+    m_text += m_indent + "  \"" + escape(name) + "\": ";
+    m_first = false;
+    return m_text;
+  }
+
+  //################################################################################################
+  void add(const std::string& name, const std::string& value)
+  {
+    key(name) += "\"" + escape(value) + "\"";
+  }
+
+  //################################################################################################
+  void add(const std::string& name, double value)
+  {
+    char buffer[64];
+    std::snprintf(buffer, sizeof(buffer), "%.9g", value);
+    key(name) += buffer;
+  }
+
+  //################################################################################################
+  void add(const std::string& name, size_t value)
+  {
+    key(name) += std::to_string(value);
+  }
+
+  //################################################################################################
+  void add(const std::string& name, bool value)
+  {
+    key(name) += value?"true":"false";
+  }
+
+private:
+  std::string& m_text;
+  std::string m_indent;
+  bool m_first{true};
+};
+
+}
+
+//##################################################################################################
+std::vector<BenchmarkResult> runBenchmarks(const std::vector<CorpusFile>& corpus,
+                                           const BenchmarkOptions& options)
+{
+  std::vector<BenchmarkResult> results;
+
+  for(const auto& file : corpus)
+  {
+    if(!options.filter.empty() && file.name.find(options.filter)==std::string::npos)
+      continue;
+
+    //-- parseOBJ ----------------------------------------------------------------------------------
+    std::vector<tp_math_utils::Geometry3D> geometry;
+    {
+      BenchmarkResult& result = results.emplace_back();
+      result.corpus = file.name;
+      result.operation = "parseOBJ";
+      result.bytes = fileSize(file.objPath);
+
+      measure(result, options.iterations, [&](tp_obj::OBJStats& stats)
+      {
+        tp_obj::ParseOptions parseOptions;
+        parseOptions.threadCount = options.threadCount;
+        parseOptions.stats = &stats;
+
+        // Time the full load rather than the MTL cache.
+        tp_obj::clearMTLCache();
+
+        std::string exporterVersion;
+        geometry.clear();
+        return tp_obj::parseOBJ(file.objPath,
+                                triangleFan,
+                                triangleStrip,
+                                triangles,
+                                false,
+                                exporterVersion,
+                                geometry,
+                                nullptr,
+                                parseOptions);
+      });
+
+      result.triangles = countTriangles(geometry);
+    }
+
+    //-- parseMTL ----------------------------------------------------------------------------------
+    if(!file.mtlPath.empty())
+    {
+      BenchmarkResult& result = results.emplace_back();
+      result.corpus = file.name;
+      result.operation = "parseMTL";
+      result.bytes = fileSize(file.mtlPath);
+
+      measure(result, options.iterations, [&](tp_obj::OBJStats& stats)
+      {
+        tp_obj::clearMTLCache();
+        std::vector<tp_math_utils::Material> materials;
+        return tp_obj::parseMTL(file.mtlPath, materials, nullptr, &stats) && materials.size()==file.materials;
+      });
+    }
+
+    //-- parseMTL from the cache -------------------------------------------------------------------
+    if(!file.mtlPath.empty())
+    {
+      BenchmarkResult& result = results.emplace_back();
+      result.corpus = file.name;
+      result.operation = "parseMTLCached";
+      result.bytes = fileSize(file.mtlPath);
+
+      std::vector<tp_math_utils::Material> warm;
+      tp_obj::parseMTL(file.mtlPath, warm, nullptr);
+
+      measure(result, options.iterations, [&](tp_obj::OBJStats& stats)
+      {
+        std::vector<tp_math_utils::Material> materials;
+        return tp_obj::parseMTL(file.mtlPath, materials, nullptr, &stats) && stats.mtlCacheHits==1;
+      });
+    }
+
+    //-- serializeOBJ ------------------------------------------------------------------------------
+    {
+      BenchmarkResult& result = results.emplace_back();
+      result.corpus = file.name;
+      result.operation = "serializeOBJ";
+      result.triangles = countTriangles(geometry);
+
+      measure(result, options.iterations, [&](tp_obj::OBJStats& stats)
+      {
+        tp_obj::WriteOptions writeOptions;
+        writeOptions.threadCount = options.threadCount;
+        writeOptions.stats = &stats;
+        result.bytes = tp_obj::serializeOBJ(geometry, file.name + ".mtl", writeOptions).size();
+        return true;
+      });
+    }
+
+    //-- serializeOBJ with deduplication -----------------------------------------------------------
+    {
+      BenchmarkResult& result = results.emplace_back();
+      result.corpus = file.name;
+      result.operation = "serializeOBJDeduplicated";
+      result.triangles = countTriangles(geometry);
+
+      measure(result, options.iterations, [&](tp_obj::OBJStats& stats)
+      {
+        tp_obj::WriteOptions writeOptions;
+        writeOptions.deduplicate = true;
+        writeOptions.stats = &stats;
+        result.bytes = tp_obj::serializeOBJ(geometry, file.name + ".mtl", writeOptions).size();
+        return true;
+      });
+    }
+
+    //-- serializeMTL ------------------------------------------------------------------------------
+    if(!file.mtlPath.empty())
+    {
+      BenchmarkResult& result = results.emplace_back();
+      result.corpus = file.name;
+      result.operation = "serializeMTL";
+
+      measure(result, options.iterations, [&](tp_obj::OBJStats&)
+      {
+        result.bytes = tp_obj::serializeMTL(geometry).size();
+        return true;
+      });
+    }
+  }
+
+  return results;
+}
+
+//##################################################################################################
+std::string resultsToJSON(const std::vector<BenchmarkResult>& results,
+                          const BenchmarkOptions& options,
+                          size_t corpusTriangles,
+                          uint64_t seed)
+{
+  std::string text;
+  {
+    JSONObject root(text, "");
+    root.add("benchmark", std::string("tp_obj"));
+    root.add("formatVersion", size_t(1));
+    root.add("corpusTriangles", corpusTriangles);
+    root.add("seed", size_t(seed));
+    root.add("iterations", options.iterations);
+    root.add("threadCount", options.threadCount);
+    root.add("peakRSSBytes", peakRSSBytes());
+
+    std::string& array = root.key("results");
+    array += "[";
+    for(size_t i=0; i<results.size(); i++)
+    {
+      const auto& r = results.at(i);
+      array += i?",\n    ":"\n    ";
+
+      JSONObject object(array, "    ");
+      object.add("corpus", r.corpus);
+      object.add("operation", r.operation);
+      object.add("ok", r.ok);
+      object.add("bytes", r.bytes);
+      object.add("triangles", r.triangles);
+      object.add("minSeconds", r.minSeconds);
+      object.add("meanSeconds", r.meanSeconds);
+      object.add("mbPerSecond", r.mbPerSecond());
+      object.add("trianglesPerSecond", r.trianglesPerSecond());
+      object.add("peakRSSBytes", r.peakRSSBytes);
+
+      const auto& s = r.stats;
+      object.add("ioSeconds", s.ioSeconds);
+      object.add("tokenizeSeconds", s.tokenizeSeconds);
+      object.add("attributeSeconds", s.attributeSeconds);
+      object.add("faceSeconds", s.faceSeconds);
+      object.add("materialSeconds", s.materialSeconds);
+      object.add("serializeSeconds", s.serializeSeconds);
+      object.add("lines", s.lines);
+      object.add("faces", s.faces);
+      object.add("outputVerts", s.outputVerts);
+      object.add("mtlCacheHits", s.mtlCacheHits);
+      object.add("dedupHitRate", s.dedupHitRate());
+      object.add("peakTemporaryBytes", s.peakTemporaryBytes);
+    }
+    array += results.empty()?"]":"\n  ]";
+  }
+  text += "\n";
+  return text;
+}
+
+//##################################################################################################
+size_t peakRSSBytes()
+{
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS counters;
+  if(GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    return size_t(counters.PeakWorkingSetSize);
+  return 0;
+#else
+  rusage usage;
+  if(getrusage(RUSAGE_SELF, &usage)!=0)
+    return 0;
+#  ifdef __APPLE__
+  return size_t(usage.ru_maxrss);
+#  else
+  return size_t(usage.ru_maxrss)*1024;
+#  endif
+#endif
+}
+
+}
@@ -0,0 +1,312 @@
+#include "tp_obj_benchmark/Corpus.h"
+
+#include "tp_utils/FileUtils.h"
+
+#include <fstream>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace tp_obj_benchmark
+{
+
+namespace
+{
+
+//##################################################################################################
+//! Deterministic random numbers, the std distributions differ between standard libraries.
+class Random
+{
+public:
+  //################################################################################################
+  Random(uint64_t seed):
+    m_state(seed)
+  {
+
+  }
+
+  //################################################################################################
+  float next(float min, float max)
+  {
+    // splitmix64
+    uint64_t z = (m_state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z>>30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z>>27)) * 0x94D049BB133111EBull;
+    z = z ^ (z>>31);
+    return min + (max-min)*float(double(z>>40) / double(1ull<<24));
+  }
+
+private:
+  uint64_t m_state;
+};
+
+//##################################################################################################
+//! Which indexes are written for each face corner.
+enum class Corners
+{
+  P,   //!< f v
+  PT,  //!< f v/vt
+  PN,  //!< f v//vn
+  PTN  //!< f v/vt/vn
+};
+
+//##################################################################################################
+class Text
+{
+public:
+  //################################################################################################
+  template<typename... Args>
+  void line(const char* format, Args... args)
+  {
+    char buffer[512];
+    int n = std::snprintf(buffer, sizeof(buffer), format, args...);
+    if(n>0)
+      text.append(buffer, std::min(size_t(n), sizeof(buffer)-1));
+  }
+
+  //################################################################################################
+  void corner(size_t i, Corners corners)
+  {
+    switch(corners)
+    {
+    case Corners::P:   line(" %zu", i);                break;
+    case Corners::PT:  line(" %zu/%zu", i, i);         break;
+    case Corners::PN:  line(" %zu//%zu", i, i);        break;
+    case Corners::PTN: line(" %zu/%zu/%zu", i, i, i);  break;
+    }
+  }
+
+  //################################################################################################
+  void face(std::initializer_list<size_t> indexes, Corners corners)
+  {
+    text += 'f';
+    for(auto i : indexes)
+      corner(i, corners);
+    text += '\n';
+  }
+
+  std::string text;
+};
+
+//##################################################################################################
+bool writeFile(const std::string& path, const std::string& text)
+{
+  std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+  stream.write(text.data(), std::streamsize(text.size()));
+  stream.close();
+  return !stream.fail();
+}
+
+//##################################################################################################
+//! Write the verts of an n by n grid of quads, returns the number of verts written.
+size_t gridVerts(Text& obj, Random& random, size_t n, float x, float y, Corners corners)
+{
+  for(size_t j=0; j<=n; j++)
+  {
+    for(size_t i=0; i<=n; i++)
+    {
+      float u = float(i)/float(n);
+      float v = float(j)/float(n);
+      obj.line("v %.6f %.6f %.6f\n", x+u, y+v, random.next(-0.01f, 0.01f));
+
+      if(corners==Corners::PT || corners==Corners::PTN)
+        obj.line("vt %.6f %.6f\n", u, v);
+
+      if(corners==Corners::PN || corners==Corners::PTN)
+        obj.line("vn %.6f %.6f %.6f\n", random.next(-0.1f, 0.1f), random.next(-0.1f, 0.1f), 1.0f);
+    }
+  }
+
+  return (n+1)*(n+1);
+}
+
+//##################################################################################################
+//! Write the faces of one row of a grid as quads or pairs of triangles, returns the triangles.
+size_t gridRow(Text& obj, size_t n, size_t row, size_t first, bool quads, Corners corners)
+{
+  for(size_t i=0; i<n; i++)
+  {
+    size_t a = first + row*(n+1) + i;
+    size_t b = a+1;
+    size_t c = b+(n+1);
+    size_t d = a+(n+1);
+
+    if(quads)
+      obj.face({a, b, c, d}, corners);
+    else
+    {
+      obj.face({a, b, c}, corners);
+      obj.face({c, d, a}, corners);
+    }
+  }
+
+  return n*2;
+}
+
+//##################################################################################################
+size_t gridSize(size_t triangles)
+{
+  return std::max(size_t(1), size_t(std::sqrt(double(triangles)/2.0)));
+}
+
+//##################################################################################################
+std::string materialLibrary(size_t count, Random& random)
+{
+  Text mtl;
+  for(size_t m=0; m<count; m++)
+  {
+    mtl.line("newmtl material_%zu\n", m);
+    mtl.line("Ka %.6f %.6f %.6f\n", random.next(0, 1), random.next(0, 1), random.next(0, 1));
+    mtl.line("Kd %.6f %.6f %.6f\n", random.next(0, 1), random.next(0, 1), random.next(0, 1));
+    mtl.line("Ks %.6f %.6f %.6f\n", random.next(0, 1), random.next(0, 1), random.next(0, 1));
+    mtl.line("Ns %.6f\n", random.next(0, 1000));
+    mtl.line("Ni %.6f\n", random.next(1, 2));
+    mtl.line("d %.6f\n", random.next(0, 1));
+    mtl.line("illum 2\n");
+    mtl.line("map_Kd -s 1 1 1 textures/albedo_%zu.png\n", m);
+    mtl.line("map_Bump -bm 1.0 textures/normals_%zu.png\n", m);
+    mtl.line("Roughness %.6f\n", random.next(0, 1));
+    mtl.line("Metalness %.6f\n", random.next(0, 1));
+    mtl.line("Emission %.6f %.6f %.6f\n", random.next(0, 1), random.next(0, 1), random.next(0, 1));
+    mtl.line("map_Roughness textures/roughness_%zu.png\n", m);
+    mtl.line("rayVisibilityShadow 1\n\n");
+  }
+  return mtl.text;
+}
+
+}
+
+//##################################################################################################
+std::vector<CorpusFile> generateCorpus(const std::string& directory,
+                                       size_t triangles,
+                                       uint64_t seed)
+{
+  std::vector<CorpusFile> files;
+  Random random(seed);
+
+  auto add = [&](const std::string& name, const Text& obj, size_t count, const std::string& mtl, size_t materials)
+  {
+    CorpusFile& file = files.emplace_back();
+    file.name = name;
+    file.objPath = tp_utils::pathAppend(directory, name + ".obj");
+    file.triangles = count;
+    file.materials = materials;
+
+    if(!writeFile(file.objPath, obj.text))
+      return false;
+
+    if(mtl.empty())
+      return true;
+
+    file.mtlPath = tp_utils::pathAppend(directory, name + ".mtl");
+    return writeFile(file.mtlPath, mtl);
+  };
+
+  //-- Triangle soup -------------------------------------------------------------------------------
+  {
+    Text obj;
+    for(size_t t=0; t<triangles; t++)
+    {
+      for(size_t c=0; c<3; c++)
+      {
+        obj.line("v %.6f %.6f %.6f\n", random.next(-100, 100), random.next(-100, 100), random.next(-100, 100));
+        obj.line("vt %.6f %.6f\n", random.next(0, 1), random.next(0, 1));
+        obj.line("vn %.6f %.6f %.6f\n", random.next(-1, 1), random.next(-1, 1), random.next(-1, 1));
+      }
+      obj.face({t*3+1, t*3+2, t*3+3}, Corners::PTN);
+    }
+
+    if(!add("triangle_soup", obj, triangles, std::string(), 0))
+      return {};
+  }
+
+  //-- Quad mesh -----------------------------------------------------------------------------------
+  {
+    Text obj;
+    size_t n = gridSize(triangles);
+    size_t count=0;
+    gridVerts(obj, random, n, 0.0f, 0.0f, Corners::PTN);
+    for(size_t row=0; row<n; row++)
+      count += gridRow(obj, n, row, 1, true, Corners::PTN);
+
+    if(!add("quad_mesh", obj, count, std::string(), 0))
+      return {};
+  }
+
+  //-- Many small objects with frequent material switches ------------------------------------------
+  {
+    constexpr size_t n = 4;
+    constexpr size_t materials = 64;
+
+    Text obj;
+    obj.line("mtllib many_objects.mtl\n");
+
+    size_t objects = std::max(size_t(1), triangles/(n*n*2));
+    size_t first=1;
+    size_t count=0;
+    for(size_t o=0; o<objects; o++)
+    {
+      obj.line("o object_%zu\n", o);
+      size_t verts = gridVerts(obj, random, n, float(o%1000), float(o/1000), Corners::PTN);
+      for(size_t row=0; row<n; row++)
+      {
+        obj.line("usemtl material_%zu\n", (o*n+row)%materials);
+        count += gridRow(obj, n, row, first, false, Corners::PTN);
+      }
+      first += verts;
+    }
+
+    if(!add("many_objects", obj, count, materialLibrary(materials, random), materials))
+      return {};
+  }
+
+  //-- Large MTL library ---------------------------------------------------------------------------
+  {
+    constexpr size_t n = 32;
+    size_t materials = std::max(size_t(256), triangles/50);
+
+    Text obj;
+    obj.line("mtllib large_mtl.mtl\n");
+
+    size_t count=0;
+    gridVerts(obj, random, n, 0.0f, 0.0f, Corners::PTN);
+    for(size_t row=0; row<n; row++)
+    {
+      obj.line("usemtl material_%zu\n", (row*7919)%materials);
+      count += gridRow(obj, n, row, 1, false, Corners::PTN);
+    }
+
+    if(!add("large_mtl", obj, count, materialLibrary(materials, random), materials))
+      return {};
+  }
+
+  //-- Positions only ------------------------------------------------------------------------------
+  {
+    Text obj;
+    size_t n = gridSize(triangles);
+    size_t count=0;
+    gridVerts(obj, random, n, 0.0f, 0.0f, Corners::P);
+    for(size_t row=0; row<n; row++)
+      count += gridRow(obj, n, row, 1, false, Corners::P);
+
+    if(!add("positions_only", obj, count, std::string(), 0))
+      return {};
+  }
+
+  //-- Positions and tex coords --------------------------------------------------------------------
+  {
+    Text obj;
+    size_t n = gridSize(triangles);
+    size_t count=0;
+    gridVerts(obj, random, n, 0.0f, 0.0f, Corners::PT);
+    for(size_t row=0; row<n; row++)
+      count += gridRow(obj, n, row, 1, false, Corners::PT);
+
+    if(!add("no_normals", obj, count, std::string(), 0))
+      return {};
+  }
+
+  return files;
+}
+
+}
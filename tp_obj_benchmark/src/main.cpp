@@ -0,0 +1,110 @@
+#include "tp_obj_benchmark/Benchmark.h"
+
+#include "tp_utils/FileUtils.h"
+
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+namespace
+{
+
+//##################################################################################################
+void printUsage()
+{
+  std::cerr << "Usage: tp_obj_benchmark [options]\n"
+               "  --directory <path>  Where to write the corpus, defaults to a temp directory.\n"
+               "  --triangles <n>     Approximate triangles in each OBJ file, default 500000.\n"
+               "  --seed <n>          Seed for the corpus generator, default 1.\n"
+               "  --iterations <n>    Times each operation is run, the fastest is kept, default 5.\n"
+               "  --threads <n>       Threads used to parse and write OBJ files, 0 for all, default 1.\n"
+               "  --filter <text>     Only run corpus files with text in their name.\n"
+               "  --output <path>     Write the JSON results to a file instead of stdout.\n";
+}
+
+}
+
+//##################################################################################################
+int main(int argc, char* argv[])
+{
+  std::string directory;
+  std::string output;
+  size_t triangles=500000;
+  uint64_t seed=1;
+  tp_obj_benchmark::BenchmarkOptions options;
+
+  for(int a=1; a<argc; a++)
+  {
+    std::string arg = argv[a];
+    if(arg=="--help" || arg=="-h")
+    {
+      printUsage();
+      return 0;
+    }
+
+    if(a+1>=argc)
+    {
+      printUsage();
+      return 1;
+    }
+
+    std::string value = argv[++a];
+    try
+    {
+      if     (arg=="--directory" ) directory = value;
+      else if(arg=="--triangles" ) triangles = size_t(std::stoull(value));
+      else if(arg=="--seed"      ) seed = std::stoull(value);
+      else if(arg=="--iterations") options.iterations = size_t(std::stoull(value));
+      else if(arg=="--threads"   ) options.threadCount = size_t(std::stoull(value));
+      else if(arg=="--filter"    ) options.filter = value;
+      else if(arg=="--output"    ) output = value;
+      else
+      {
+        printUsage();
+        return 1;
+      }
+    }
+    catch(...)
+    {
+      std::cerr << "Invalid value for " << arg << ": " << value << std::endl;
+      return 1;
+    }
+  }
+
+  if(directory.empty())
+    directory = (std::filesystem::temp_directory_path() / "tp_obj_benchmark").string();
+
+  std::error_code ec;
+  std::filesystem::create_directories(directory, ec);
+  if(ec)
+  {
+    std::cerr << "Failed to create directory: " << directory << std::endl;
+    return 1;
+  }
+
+  std::cerr << "Generating corpus in: " << directory << std::endl;
+  auto corpus = tp_obj_benchmark::generateCorpus(directory, triangles, seed);
+  if(corpus.empty())
+  {
+    std::cerr << "Failed to write corpus." << std::endl;
+    return 1;
+  }
+
+  std::cerr << "Running benchmarks." << std::endl;
+  auto results = tp_obj_benchmark::runBenchmarks(corpus, options);
+  std::string json = tp_obj_benchmark::resultsToJSON(results, options, triangles, seed);
+
+  if(output.empty())
+    std::cout << json;
+  else if(!tp_utils::writeTextFile(output, json))
+  {
+    std::cerr << "Failed to write results: " << output << std::endl;
+    return 1;
+  }
+
+  for(const auto& result : results)
+    if(!result.ok)
+      return 2;
+
+  return 0;
+}
@@ -0,0 +1,10 @@
+TARGET = tp_obj_benchmark
+TEMPLATE = app
+
+SOURCES += src/main.cpp
+
+SOURCES += src/Corpus.cpp
+HEADERS += inc/tp_obj_benchmark/Corpus.h
+
+SOURCES += src/Benchmark.cpp
+HEADERS += inc/tp_obj_benchmark/Benchmark.h
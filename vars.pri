@@ -3,6 +3,9 @@ TEMPLATE = lib
 
 DEFINES += TP_OBJ_LIBRARY
 
+# To read and write compressed files define TP_OBJ_ZLIB and link zlib for gzip, or define
+# TP_OBJ_ZSTD and link libzstd for zstd.
+
 SOURCES += src/Globals.cpp
 HEADERS += inc/tp_obj/Globals.h
 
@@ -14,3 +17,67 @@ HEADERS += inc/tp_obj/ReadOBJ.h
 
 SOURCES += src/OBJParser.cpp
 HEADERS += inc/tp_obj/OBJParser.h
+
+SOURCES += src/Tokenizer.cpp
+HEADERS += inc/tp_obj/Tokenizer.h
+
+SOURCES += src/NumberParsing.cpp
+HEADERS += inc/tp_obj/NumberParsing.h
+
+SOURCES += src/VertexIndexMap.cpp
+HEADERS += inc/tp_obj/VertexIndexMap.h
+
+SOURCES += src/Parallel.cpp
+HEADERS += inc/tp_obj/Parallel.h
+
+HEADERS += inc/tp_obj/ParseOptions.h
+
+SOURCES += src/OBJReader.cpp
+HEADERS += inc/tp_obj/OBJReader.h
+
+SOURCES += src/OBJCache.cpp
+HEADERS += inc/tp_obj/OBJCache.h
+
+SOURCES += src/OBJStats.cpp
+HEADERS += inc/tp_obj/OBJStats.h
+
+SOURCES += src/OutputBuffer.cpp
+HEADERS += inc/tp_obj/OutputBuffer.h
+
+HEADERS += inc/tp_obj/WriteOptions.h
+
+SOURCES += src/MTLParser.cpp
+HEADERS += inc/tp_obj/MTLProperties.h
+
+SOURCES += src/FileStamp.cpp
+HEADERS += inc/tp_obj/FileStamp.h
+
+SOURCES += src/MTLCache.cpp
+HEADERS += inc/tp_obj/MTLCache.h
+
+SOURCES += src/MaterialIndex.cpp
+HEADERS += inc/tp_obj/MaterialIndex.h
+
+SOURCES += src/MaterialPrefetch.cpp
+HEADERS += inc/tp_obj/MaterialPrefetch.h
+
+SOURCES += src/Compression.cpp
+HEADERS += inc/tp_obj/Compression.h
+
+SOURCES += src/BinaryFile.cpp
+HEADERS += inc/tp_obj/BinaryFile.h
+
+SOURCES += src/OBJIndex.cpp
+HEADERS += inc/tp_obj/OBJIndex.h
+
+SOURCES += src/PolygonTriangulator.cpp
+HEADERS += inc/tp_obj/PolygonTriangulator.h
+
+SOURCES += src/OBJMeshBuffers.cpp
+HEADERS += inc/tp_obj/OBJMeshBuffers.h
+
+SOURCES += src/VertexOrder.cpp
+HEADERS += inc/tp_obj/VertexOrder.h
+
+SOURCES += src/VertexWeld.cpp
+HEADERS += inc/tp_obj/VertexWeld.h